@@ -1,17 +1,29 @@
 #include "ambulance.h"
 #include "costs.h"
 #include <pcosynchro/pcothread.h>
+#include <algorithm>
+#include "trace.h"
+#include "conservationAuditor.h"
+#include "transactionLog.h"
+#include "checkpoint.h"
+#include "placement.h"
 
 Ambulance::Ambulance(int uniqueId, int fund, std::vector<ItemType> resourcesSupplied, std::map<ItemType, int> initialStocks)
-    : SellerInterface(fund, uniqueId), resourcesSupplied(resourcesSupplied), nbTransfer(0) 
+    : SellerInterface(fund, uniqueId), resourcesSupplied(resourcesSupplied), nbTransfer(0), pendingArrivals(0), openLoop(false)
 {
     for (const auto& item : resourcesSupplied) {
         if (initialStocks.find(item) != initialStocks.end()) {
             stocks[item] = initialStocks[item];
+            if (item == ItemType::PatientSick) {
+                for (int i = 0; i < initialStocks[item]; ++i) {
+                    sickPatientIds.push_back(PatientTracker::registerPatient());
+                }
+            }
         } else {
             stocks[item] = 0;
         }
     }
+    publishSnapshot();
 
     interfaceMessage(QString("Ambulance Created"));
     updateInterface();
@@ -22,45 +34,113 @@ int& Ambulance::getNumberSick(){
 }
 
 void Ambulance::sendPatient(){
-    if(getNumberPatients() <= 0){
+    TraceSpan span("sendPatient", uniqueId);
+
+    {
+        ReplayTurn admit(ReplayOp::Admit);
+        PatientId arrived;
+        while (arrivals.pop(arrived)) {
+            sickPatientIds.push_back(arrived);
+            ++getNumberSick();
+            --pendingArrivals;
+        }
+    }
+
+    if(getNumberSick() <= 0){
         interfaceMessage(QString("No patient to send"));
         return;
     }
 
-    Seller* chosenHospital = chooseRandomSeller(hospitals);
+    // Choosing takes the hospitals' locks, it works on a copy so that no read section is held while waiting for them
+    std::vector<Seller*> candidates = hospitals.copy();
+    Seller* chosenHospital = candidates.empty() ? nullptr : chooseHospital(candidates);
 
     if(!chosenHospital){
         interfaceMessage(QString("No hospital to send patient"));
         return;
     }
 
+    // The batch is sized from the beds the hospital advertises, it may still accept only part of it
+    int batch = std::min({getNumberSick(), MAX_PATIENTS_PER_TRANSFER,
+                          std::max(1, chosenHospital->getAdmissionCapacity(ItemType::PatientSick))});
+
+    // The hospital takes the identifiers of the patients it admits, the others come back to the ambulance
+    PatientTracker::handoff().clear();
+    givePatients(ItemType::PatientSick, batch);
+
     static int patientCost = getCostPerUnit(ItemType::PatientSick);
-    int sent = chosenHospital->send(ItemType::PatientSick,
-                                    MAX_PATIENTS_PER_TRANSFER,
-                                    MAX_PATIENTS_PER_TRANSFER * patientCost);
+    int sent;
+    {
+        TraceFlow flow(uniqueId);
+        sent = chosenHospital->sendBlocking(ItemType::PatientSick,
+                                            batch,
+                                            batch * patientCost,
+                                            ADMISSION_TIMEOUT_SECONDS);
+    }
+
+    restorePatients(ItemType::PatientSick);
 
     if(sent > 0){
+        countCrossRegion(chosenHospital);
         static int employeeSalary = getEmployeeSalary(EmployeeType::Supplier);
 
-        --getNumberSick();
-        money += patientCost;
+        getNumberSick() -= sent;
+        money += sent * patientCost;
         money -= employeeSalary;
-        ++nbTransfer;
-
-        interfaceMessage(QString("Sent %1 patient to hospital %2")
-            .arg(MAX_PATIENTS_PER_TRANSFER)
+        nbTransfer.fetch_add(1, std::memory_order_relaxed);
+        ConservationAuditor::record(AuditQuantity::Patients, -sent);
+        ConservationAuditor::record(AuditQuantity::Funds, sent * patientCost - employeeSalary);
+        ConservationAuditor::record(AuditQuantity::Paid, employeeSalary);
+        TransactionLog::append(TransactionKind::Transfer, uniqueId, static_cast<int>(ItemType::PatientSick), sent,
+                               sent * patientCost - employeeSalary, money);
+
+        interfaceMessage(QString("Sent %1 patient%2 to hospital %3")
+            .arg(sent)
+            .arg(sent > 1 ? "s" : "")
             .arg(chosenHospital->getUniqueId()));
     } else {
         interfaceMessage(QString("Failed to send patient to hospital"));
     }
 }
 
+Seller* Ambulance::chooseHospital(const std::vector<Seller*>& hospitals) {
+    std::vector<Seller*> local;
+    for (Seller* hospital : hospitals) {
+        if (hospital->getRegion() == region) {
+            local.push_back(hospital);
+        }
+    }
+    if (local.size() == hospitals.size() || local.empty()) {
+        return chooseRandomSeller(hospitals);
+    }
+
+    Seller* localHospital = chooseRandomSeller(local);
+    if (localHospital->getAdmissionCapacity(ItemType::PatientSick) > 0) {
+        return localHospital;
+    }
+
+    // Rather than waiting for a local bed, the patients go to another region's hospital that has one
+    std::vector<Seller*> remote;
+    for (Seller* hospital : hospitals) {
+        if (hospital->getRegion() != region && hospital->getAdmissionCapacity(ItemType::PatientSick) > 0) {
+            remote.push_back(hospital);
+        }
+    }
+    return remote.empty() ? localHospital : chooseRandomSeller(remote);
+}
+
 void Ambulance::run() {
     interfaceMessage(QString("[START] Ambulance routine"));
+    Trace::setActorName(uniqueId, QString("Ambulance %1").arg(uniqueId));
+
+    Replay::setActor(uniqueId);
+    Placement::apply(uniqueId);
+
+    while (keepRunning()) {
+        AuditScope audit;
 
-    while (!finished && getNumberPatients() > 0) {
-    
         sendPatient();
+        publishSnapshot();
         
         simulateWork();
 
@@ -71,7 +151,7 @@ void Ambulance::run() {
 }
 
 std::map<ItemType, int> Ambulance::getItemsForSale() {
-    return stocks;
+    return getSnapshot().toMap();
 }
 
 int Ambulance::getMaterialCost() {
@@ -83,11 +163,31 @@ int Ambulance::getMaterialCost() {
 }
 
 int Ambulance::getAmountPaidToWorkers() {
-    return nbTransfer * getEmployeeSalary(EmployeeType::Supplier);
+    return nbTransfer.load(std::memory_order_relaxed) * getEmployeeSalary(EmployeeType::Supplier);
 }
 
 int Ambulance::getNumberPatients(){
-    return stocks[ItemType::PatientSick];
+    return getSnapshot().getStock(ItemType::PatientSick) + pendingArrivals;
+}
+
+bool Ambulance::keepRunning() {
+    ReplayTurn step(ReplayOp::Step);
+    // The ambulance's own thread reads its stock directly, the snapshot is only published after each trip
+    return !finished && (openLoop || getNumberSick() + pendingArrivals > 0);
+}
+
+void Ambulance::admitArrivals(int nbPatients) {
+    AuditScope audit;
+    for (int i = 0; i < nbPatients; ++i) {
+        arrivals.push(PatientTracker::registerPatient());
+    }
+    pendingArrivals += nbPatients;
+    ConservationAuditor::record(AuditQuantity::Arrivals, nbPatients);
+    ConservationAuditor::record(AuditQuantity::Patients, nbPatients);
+}
+
+void Ambulance::setOpenLoop(bool openLoop) {
+    this->openLoop = openLoop;
 }
 
 void Ambulance::setHospitals(std::vector<Seller*> hospitals){
@@ -98,6 +198,20 @@ void Ambulance::setHospitals(std::vector<Seller*> hospitals){
     }
 }
 
+void Ambulance::addHospital(Seller* hospital) {
+    if (hospitals.add(hospital)) {
+        setLink(hospital->getUniqueId());
+    }
+}
+
+void Ambulance::removeHospital(Seller* hospital) {
+    hospitals.remove(hospital);
+}
+
+std::vector<Seller*> Ambulance::getTradingPartners() {
+    return hospitals.copy();
+}
+
 int Ambulance::send(ItemType it, int qty, int bill) {
     return 0;
 }
@@ -111,3 +225,21 @@ std::vector<ItemType> Ambulance::getResourcesSupplied() const
 {
     return resourcesSupplied;
 }
+
+void Ambulance::saveState(CheckpointRecord& record, CheckpointWriter& writer) {
+    Seller::saveState(record, writer);
+    record.counters[0] = nbTransfer.load(std::memory_order_relaxed);
+    record.counters[1] = pendingArrivals;
+    record.lists[0] = writer.addList(hospitals.copy());
+}
+
+void Ambulance::restoreState(const CheckpointRecord& record, const CheckpointReader& checkpoint) {
+    Seller::restoreState(record, checkpoint);
+    nbTransfer.store(record.counters[0], std::memory_order_relaxed);
+    for (int i = 0; i < record.counters[1]; ++i) {
+        arrivals.push(PatientTracker::UNTRACKED);
+    }
+    pendingArrivals = record.counters[1];
+    hospitals = checkpoint.getSellers(record.lists[0]);
+    updateInterface();
+}
@@ -2,12 +2,16 @@
 #define AMBULANCE_H
 
 #include <QTimer>
+#include <atomic>
 #include <pcosynchro/pcomutex.h>
 
 #include "costs.h"
 #include "sellerInterface.h"
+#include "sellerList.h"
+#include "mpscQueue.h"
 
-#define MAX_PATIENTS_PER_TRANSFER 1
+#define MAX_PATIENTS_PER_TRANSFER 10
+#define ADMISSION_TIMEOUT_SECONDS 1
 
 /**
  * @brief La classe Ambulance représente une ambulance capable de transporter des patients
@@ -67,6 +71,10 @@ public:
      */
     int getAmountPaidToWorkers();
 
+    /**
+     * @brief getNumberPatients
+     * @return Les patients malades de l'instantané publié, plus les arrivées pas encore chargées
+     */
     int getNumberPatients();
 
     /**
@@ -76,20 +84,69 @@ public:
      */
     void setHospitals(std::vector<Seller*> hospitals);
 
+    /**
+     * @brief addHospital
+     * @param hospital Hôpital vers lequel l'ambulance transférera aussi ses patients, peut être appelée pendant la simulation
+     */
+    void addHospital(Seller* hospital);
+
+    /**
+     * @brief removeHospital
+     * @param hospital Hôpital vers lequel l'ambulance ne transfère plus de patients, peut être appelée pendant la simulation
+     */
+    void removeHospital(Seller* hospital);
+
+    /**
+     * @brief getTradingPartners
+     * @return Les hôpitaux auxquels l'ambulance transfère ses patients
+     */
+    std::vector<Seller*> getTradingPartners() override;
+
+    /**
+     * @brief admitArrivals
+     * @param nbPatients Nombre de nouveaux patients malades confiés à l'ambulance
+     * Peut être appelée depuis n'importe quel thread, les patients sont pris en charge au prochain envoi.
+     */
+    void admitArrivals(int nbPatients);
+
+    /**
+     * @brief setOpenLoop
+     * @param openLoop true si l'ambulance reçoit des patients en continu et doit tourner jusqu'à la fin du service
+     */
+    void setOpenLoop(bool openLoop);
+
     /**
      * @brief getResourcesSupplied
      * @return Les ressources fournies par cette ambulance
      */
     std::vector<ItemType> getResourcesSupplied() const;
 
+    /**
+     * @brief saveState
+     * Sauvegarde aussi le nombre de trajets, les patients arrivés pas encore chargés et les hôpitaux liés
+     */
+    void saveState(CheckpointRecord& record, CheckpointWriter& writer) override;
+
+    void restoreState(const CheckpointRecord& record, const CheckpointReader& checkpoint) override;
+
 protected:
     /**
      * @brief sendPatient
      * Fonction responsable de l'envoi d'un patient à l'hôpital ou à la clinique.
      * Cette méthode gère les détails logistiques de la transmission d'un patient.
+     * L'ambulance attend au plus ADMISSION_TIMEOUT_SECONDS qu'un lit se libère dans l'hôpital choisi.
+     * Chaque trajet transporte jusqu'à MAX_PATIENTS_PER_TRANSFER patients, selon les lits libres annoncés par l'hôpital.
      */
     void sendPatient();
 
+    /**
+     * @brief chooseHospital
+     * @param hospitals Copie des hôpitaux de l'ambulance, le choix prend leurs verrous hors de toute section de lecture
+     * @return Un hôpital de la région de l'ambulance. S'il n'a pas de lit libre, un hôpital d'une autre région qui en a,
+     *         sinon l'hôpital de la région choisi, où l'ambulance attendra un lit
+     */
+    Seller* chooseHospital(const std::vector<Seller*>& hospitals);
+
     /*
      * @brief sendPatient
      * Fonction responsable de l'envoi d'un patient à l'hôpital ou à la clinique.
@@ -97,10 +154,20 @@ protected:
      */
     int& getNumberSick();
 
+    /**
+     * @brief keepRunning
+     * @return true tant que le service continue et que l'ambulance a ou attend des patients
+     */
+    bool keepRunning();
+
 
     std::vector<ItemType> resourcesSupplied;  // Liste des items que ce fournisseur gère (ressources de l'ambulance)
-    int nbTransfer;  // Nombre total d'items (patients) transférés par l'ambulance
-    std::vector<Seller*> hospitals;  // Liste des hôpitaux associés à cette ambulance
+    std::atomic<int> nbTransfer;  // Nombre total de trajets vers un hôpital, un(e) ambulancier(ère) est payé(e) par trajet
+    SellerList hospitals;            // Liste des hôpitaux associés à cette ambulance
+
+    MpscQueue<PatientId> arrivals;     // Identifiants des patients arrivés mais pas encore chargés dans les stocks
+    std::atomic<int> pendingArrivals;  // Nombre de patients dans arrivals
+    bool openLoop;                     // L'ambulance attend de nouveaux patients au lieu de s'arrêter lorsqu'elle est vide
 };
 
 #endif // AMBULANCE_H
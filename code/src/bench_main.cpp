@@ -0,0 +1,236 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <vector>
+
+#include "iwindowinterface.h"
+#include "supplier.h"
+#include "hospital.h"
+#include "worldView.h"
+
+/**
+ * pco_hospital_bench [options de Google Benchmark]
+ * Microbenchmarks des chemins critiques des vendeurs, chacun paramétré par le nombre de vendeurs partagés
+ * et le nombre de threads. Pour comparer deux builds :
+ *   pco_hospital_bench --benchmark_out=before.json --benchmark_out_format=json
+ *   compare.py benchmarks before.json after.json   (outil fourni avec Google Benchmark)
+ */
+
+#define BENCH_FUND 1000000000       // Argent des vendeurs, assez pour ne jamais manquer pendant une mesure
+#define BENCH_STOCK 1000000         // Stock remis aux fournisseurs lorsqu'ils sont vides
+#define BENCH_BEDS 1000000          // Lits des hôpitaux, assez pour ne jamais refuser d'admission
+#define BENCH_MAX_THREADS 8
+
+/**
+ * @brief The NullInterface class
+ * Interface sans affichage, seul le coût côté vendeur (formatage et mutex de l'interface) est mesuré
+ */
+class NullInterface : public IWindowInterface {
+public:
+    void consoleAppendText(unsigned int consoleId, QString text) override {}
+    void updateFund(unsigned int id, unsigned new_fund) override {}
+    void updateStock(unsigned int id, std::map<ItemType, int>* stocks) override {}
+    void setLink(int from, int to) override {}
+    void setUtils(Utils* utils) override {}
+    void simulateWork() override {}
+};
+
+/**
+ * @brief The BenchSupplier class
+ * Fournisseur dont le stock est remis à niveau par le benchmark plutôt que par sa routine
+ */
+class BenchSupplier : public MedicalDeviceSupplier {
+public:
+    BenchSupplier(int uniqueId) : MedicalDeviceSupplier(uniqueId, 0) { restock(); }
+
+    void restock() {
+        lockMutex();
+        stocks[ItemType::Scalpel] = BENCH_STOCK;
+        money = 0;
+        unlockMutex();
+    }
+};
+
+/**
+ * @brief The BenchBuyer class
+ * Acheteur exposant les chemins protégés de SellerMutex
+ */
+class BenchBuyer : public SellerMutex {
+public:
+    BenchBuyer(int uniqueId) : SellerMutex(BENCH_FUND, uniqueId) {}
+
+    std::map<ItemType, int> getItemsForSale() override { return {}; }
+    int send(ItemType what, int qty, int bill) override { return 0; }
+    int request(ItemType what, int qty) override { return 0; }
+
+    int buy(std::vector<Seller*>& sellers, ItemType item, int qty) {
+        if (getFund() < BENCH_FUND / 2) {
+            lockMutex();
+            money = BENCH_FUND;
+            unlockMutex();
+        }
+        return buyFromSellers(sellers, item, qty);
+    }
+
+    void message(ItemType item, int qty) {
+        interfaceMessage(QString("Sold %1 %2").arg(qty).arg(getItemName(item)));
+    }
+};
+
+namespace {
+
+// Shared by the threads of one benchmark run, built by thread 0 before the threads start measuring
+std::vector<std::unique_ptr<Hospital>> hospitals;
+std::vector<std::unique_ptr<BenchSupplier>> suppliers;
+std::vector<std::unique_ptr<BenchBuyer>> buyers;
+std::vector<Seller*> sellers;
+
+template<typename T>
+void createSellers(std::vector<std::unique_ptr<T>>& created, int count) {
+    created.clear();
+    sellers.clear();
+    for (int i = 0; i < count; ++i) {
+        created.push_back(std::make_unique<T>(i));
+        sellers.push_back(created.back().get());
+    }
+}
+
+void createHospitals(int count) {
+    hospitals.clear();
+    sellers.clear();
+    for (int i = 0; i < count; ++i) {
+        hospitals.push_back(std::make_unique<Hospital>(i, BENCH_FUND, BENCH_BEDS));
+        sellers.push_back(hospitals.back().get());
+    }
+}
+
+}
+
+static void BM_HospitalSendRequest(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        createHospitals(state.range(0));
+    }
+    const int bill = getCostPerUnit(ItemType::PatientSick);
+    for (auto _ : state) {
+        Hospital* hospital = hospitals[state.thread_index() % hospitals.size()].get();
+        benchmark::DoNotOptimize(hospital->send(ItemType::PatientSick, 1, bill));
+        benchmark::DoNotOptimize(hospital->request(ItemType::PatientSick, 1));
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+    if (state.thread_index() == 0) {
+        hospitals.clear();
+    }
+}
+
+static void BM_SupplierRequest(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        createSellers(suppliers, state.range(0));
+    }
+    for (auto _ : state) {
+        BenchSupplier* supplier = suppliers[state.thread_index() % suppliers.size()].get();
+        if (supplier->request(ItemType::Scalpel, 1) == 0) {
+            supplier->restock();
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        suppliers.clear();
+    }
+}
+
+static void BM_BuyFromSellers(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        createSellers(suppliers, state.range(0));
+        buyers.clear();
+        for (int i = 0; i < BENCH_MAX_THREADS; ++i) {
+            buyers.push_back(std::make_unique<BenchBuyer>(state.range(0) + i));
+        }
+    }
+    for (auto _ : state) {
+        BenchBuyer* buyer = buyers[state.thread_index()].get();
+        if (buyer->buy(sellers, ItemType::Scalpel, 1) == 0) {
+            for (auto& supplier : suppliers) {
+                supplier->restock();
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        buyers.clear();
+        suppliers.clear();
+    }
+}
+
+static void BM_ChooseRandomSeller(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        createSellers(buyers, state.range(0));
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Seller::chooseRandomSeller(sellers));
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        buyers.clear();
+    }
+}
+
+static void BM_InterfaceMessage(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        createSellers(buyers, state.range(0));
+    }
+    for (auto _ : state) {
+        buyers[state.thread_index() % buyers.size()]->message(ItemType::Scalpel, 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        buyers.clear();
+    }
+}
+
+static void BM_WorldKernels(benchmark::State& state) {
+    std::vector<int32_t> funds(state.range(0));
+    std::vector<int32_t> occupied(state.range(0));
+    std::vector<int32_t> capacity(state.range(0), BENCH_BEDS);
+    for (size_t i = 0; i < funds.size(); ++i) {
+        funds[i] = int32_t(i * 7919 % BENCH_FUND);
+        occupied[i] = int32_t(i * 104729 % BENCH_BEDS);
+    }
+    uint64_t bins[WORLD_VIEW_OCCUPANCY_BINS + 1];
+    for (auto _ : state) {
+        int32_t min = 0;
+        int32_t max = 0;
+        benchmark::DoNotOptimize(WorldKernels::sum(funds.data(), funds.size()));
+        WorldKernels::minMax(funds.data(), funds.size(), min, max);
+        WorldKernels::occupancyHistogram(occupied.data(), capacity.data(), occupied.size(), bins, WORLD_VIEW_OCCUPANCY_BINS);
+        benchmark::DoNotOptimize(min);
+        benchmark::DoNotOptimize(max);
+        benchmark::DoNotOptimize(bins);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Sellers shared by the threads : 1 (every thread contends) to 16 (threads mostly work on distinct sellers)
+#define SELLER_BENCHMARK(function) \
+    BENCHMARK(function)->ArgName("sellers")->Arg(1)->Arg(4)->Arg(16)->ThreadRange(1, BENCH_MAX_THREADS)->UseRealTime()
+
+SELLER_BENCHMARK(BM_HospitalSendRequest);
+SELLER_BENCHMARK(BM_SupplierRequest);
+SELLER_BENCHMARK(BM_BuyFromSellers);
+SELLER_BENCHMARK(BM_ChooseRandomSeller);
+SELLER_BENCHMARK(BM_InterfaceMessage);
+
+// Aggregates over the columns of a WorldView, one value per entity
+BENCHMARK(BM_WorldKernels)->ArgName("entities")->Arg(1000)->Arg(100000);
+
+int main(int argc, char *argv[])
+{
+    NullInterface interface;
+    SellerInterface::setInterface(&interface);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
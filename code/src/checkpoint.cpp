@@ -0,0 +1,145 @@
+#include "checkpoint.h"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char CHECKPOINT_MAGIC[8] = {'P', 'C', 'O', 'C', 'K', 'P', 'T', '1'};
+const uint32_t CHECKPOINT_VERSION = 2;
+
+}
+
+std::string Checkpoint::loadPath;
+std::string Checkpoint::savePath;
+
+void Checkpoint::configure(const QString& load, const QString& save) {
+    loadPath = load.toStdString();
+    savePath = save.toStdString();
+}
+
+CheckpointRecord& CheckpointWriter::addRecord(CheckpointKind kind) {
+    records.emplace_back();
+    CheckpointRecord& record = records.back();
+    std::memset(&record, 0, sizeof(record));
+    record.kind = static_cast<uint32_t>(kind);
+    return record;
+}
+
+CheckpointList CheckpointWriter::addList(const std::vector<Seller*>& sellers) {
+    CheckpointList list{static_cast<uint32_t>(ids.size()), static_cast<uint32_t>(sellers.size())};
+    for (Seller* seller : sellers) {
+        ids.push_back(seller->getUniqueId());
+    }
+    return list;
+}
+
+CheckpointList CheckpointWriter::addList(const std::vector<int>& sellerIds) {
+    CheckpointList list{static_cast<uint32_t>(ids.size()), static_cast<uint32_t>(sellerIds.size())};
+    ids.insert(ids.end(), sellerIds.begin(), sellerIds.end());
+    return list;
+}
+
+bool CheckpointWriter::write(const QString& path, uint64_t nbArrivals) {
+    CheckpointHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    header.version = CHECKPOINT_VERSION;
+    header.recordSize = sizeof(CheckpointRecord);
+    header.nbItems = NB_ITEM_TYPES;
+    header.nbDaysOfRest = NB_DAYS_OF_REST;
+    header.nbSellers = records.size();
+    header.nbIds = ids.size();
+    header.nbArrivals = nbArrivals;
+
+    // Written next to the target then renamed, an interrupted save never replaces a valid checkpoint
+    std::string file = path.toStdString();
+    std::string tmp = file + ".tmp";
+    FILE* out = std::fopen(tmp.c_str(), "wb");
+    if (!out) {
+        std::cerr << "Cannot write the checkpoint " << file << std::endl;
+        return false;
+    }
+    bool written = std::fwrite(&header, sizeof(header), 1, out) == 1 &&
+                   std::fwrite(records.data(), sizeof(CheckpointRecord), records.size(), out) == records.size() &&
+                   (ids.empty() || std::fwrite(ids.data(), sizeof(uint32_t), ids.size(), out) == ids.size());
+    written = (std::fclose(out) == 0) && written;
+    if (!written || std::rename(tmp.c_str(), file.c_str()) != 0) {
+        std::cerr << "Cannot write the checkpoint " << file << std::endl;
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+CheckpointReader::CheckpointReader() : mapping(nullptr), mappingSize(0), header(nullptr), records(nullptr), ids(nullptr) {}
+
+CheckpointReader::~CheckpointReader() {
+    if (mapping) {
+        ::munmap(mapping, mappingSize);
+    }
+}
+
+bool CheckpointReader::open(const QString& path) {
+    std::string file = path.toStdString();
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat status;
+    if (::fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(CheckpointHeader)) {
+        ::close(fd);
+        return false;
+    }
+    mappingSize = status.st_size;
+    mapping = ::mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        return false;
+    }
+
+    header = static_cast<const CheckpointHeader*>(mapping);
+    if (std::memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0 || header->version != CHECKPOINT_VERSION ||
+        header->recordSize != sizeof(CheckpointRecord) || header->nbItems != NB_ITEM_TYPES || header->nbDaysOfRest != NB_DAYS_OF_REST) {
+        return false;
+    }
+    if (mappingSize != sizeof(CheckpointHeader) + size_t(header->nbSellers) * sizeof(CheckpointRecord) + size_t(header->nbIds) * sizeof(uint32_t)) {
+        return false;
+    }
+    records = reinterpret_cast<const CheckpointRecord*>(static_cast<const char*>(mapping) + sizeof(CheckpointHeader));
+    ids = reinterpret_cast<const uint32_t*>(records + header->nbSellers);
+
+    for (size_t i = 0; i < header->nbSellers; ++i) {
+        for (const CheckpointList& list : records[i].lists) {
+            if (list.first > header->nbIds || list.count > header->nbIds - list.first) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool CheckpointReader::setSellers(const std::map<int, Seller*>& directory) {
+    for (size_t i = 0; i < header->nbIds; ++i) {
+        if (directory.find(ids[i]) == directory.end()) {
+            return false;
+        }
+    }
+    sellers = directory;
+    return true;
+}
+
+std::vector<Seller*> CheckpointReader::getSellers(CheckpointList list) const {
+    std::vector<Seller*> result;
+    result.reserve(list.count);
+    for (uint32_t i = list.first; i < list.first + list.count; ++i) {
+        result.push_back(sellers.at(ids[i]));
+    }
+    return result;
+}
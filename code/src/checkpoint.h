@@ -0,0 +1,164 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include <QString>
+
+#include "seller.h"
+#include "hospital.h"
+
+#define CHECKPOINT_NB_COUNTERS 4            // Compteurs propres à chaque type de vendeur
+#define CHECKPOINT_NB_LISTS 3               // Listes d'identifiants propres à chaque type de vendeur
+#define CHECKPOINT_NO_STOCK INT32_MIN       // L'item n'a pas d'entrée dans les stocks du vendeur
+
+enum class CheckpointKind : uint32_t { Ambulance, Supplier, Clinic, Hospital };
+
+/**
+ * @brief The CheckpointList struct
+ * Une liste de count identifiants de vendeurs, à partir de first dans la table des identifiants
+ */
+struct CheckpointList {
+    uint32_t first;
+    uint32_t count;
+};
+
+/**
+ * @brief The CheckpointRecord struct
+ * L'état d'un vendeur, de taille fixe pour être lu directement dans le fichier projeté.
+ * La signification des compteurs et des listes dépend du type du vendeur, voir ses saveState/restoreState.
+ */
+struct CheckpointRecord {
+    uint32_t uniqueId;
+    uint32_t kind;                                  // CheckpointKind
+    int32_t money;
+    int32_t stocks[NB_ITEM_TYPES];                  // CHECKPOINT_NO_STOCK si l'item n'est pas en stock
+    int32_t counters[CHECKPOINT_NB_COUNTERS];
+    int32_t healedPatientsQueue[NB_DAYS_OF_REST];
+    uint64_t tradesAccepted;
+    uint64_t tradesRefused;
+    uint64_t tradesCrossRegion;
+    CheckpointList lists[CHECKPOINT_NB_LISTS];
+};
+
+/**
+ * @brief The CheckpointHeader struct
+ * Début du fichier, suivi des enregistrements des vendeurs puis de la table des identifiants
+ */
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t nbItems;
+    uint32_t nbDaysOfRest;
+    uint32_t nbSellers;
+    uint32_t nbIds;
+    uint64_t nbArrivals;                            // Patients arrivés depuis le début de la simulation
+};
+
+static_assert(sizeof(CheckpointHeader) % alignof(CheckpointRecord) == 0, "The checkpoint records must stay aligned in the mapping");
+
+/**
+ * @brief The Checkpoint class
+ * Chemins de chargement et de sauvegarde de l'état complet de la simulation. Le point de reprise est chargé à la
+ * création de Utils, avant le lancement des threads, et sauvegardé une fois tous les threads terminés :
+ * l'état sauvegardé est donc cohérent sans arrêter la simulation en cours de route.
+ */
+class Checkpoint {
+public:
+    /**
+     * @brief configure
+     * @param loadPath Point de reprise chargé au démarrage, vide pour partir de l'état initial
+     * @param savePath Fichier où sauvegarder l'état à la fin de la simulation, vide pour ne pas le sauvegarder
+     * Doit être appelée avant la création de Utils.
+     */
+    static void configure(const QString& loadPath, const QString& savePath);
+
+    static const std::string& getLoadPath() { return loadPath; }
+
+    static const std::string& getSavePath() { return savePath; }
+
+private:
+    static std::string loadPath;
+    static std::string savePath;
+};
+
+/**
+ * @brief The CheckpointWriter class
+ * Construit le point de reprise en mémoire, vendeur par vendeur, puis l'écrit d'un bloc
+ */
+class CheckpointWriter {
+public:
+    /**
+     * @brief addRecord
+     * @return Un enregistrement à zéro, valide jusqu'au prochain addRecord
+     */
+    CheckpointRecord& addRecord(CheckpointKind kind);
+
+    CheckpointList addList(const std::vector<Seller*>& sellers);
+
+    CheckpointList addList(const std::vector<int>& ids);
+
+    /**
+     * @brief write
+     * @param path Fichier remplacé s'il existe
+     * @param nbArrivals Patients arrivés depuis le début de la simulation
+     * @return false si le fichier ne peut pas être écrit
+     */
+    bool write(const QString& path, uint64_t nbArrivals);
+
+private:
+    std::vector<CheckpointRecord> records;
+    std::vector<uint32_t> ids;
+};
+
+/**
+ * @brief The CheckpointReader class
+ * Projette un point de reprise en mémoire en lecture seule ; les enregistrements sont lus en place, sans décodage.
+ */
+class CheckpointReader {
+public:
+    CheckpointReader();
+    ~CheckpointReader();
+
+    CheckpointReader(const CheckpointReader&) = delete;
+    CheckpointReader& operator=(const CheckpointReader&) = delete;
+
+    /**
+     * @brief open
+     * @return false si le fichier n'est pas un point de reprise valide pour cette version du programme
+     */
+    bool open(const QString& path);
+
+    size_t size() const { return header->nbSellers; }
+
+    const CheckpointRecord& operator[](size_t i) const { return records[i]; }
+
+    uint64_t getNbArrivals() const { return header->nbArrivals; }
+
+    /**
+     * @brief setSellers
+     * @param sellers Les vendeurs de la simulation par identifiant, utilisés par getSellers
+     * @return false si la table des identifiants désigne un vendeur inconnu
+     */
+    bool setSellers(const std::map<int, Seller*>& sellers);
+
+    /**
+     * @brief getSellers
+     * @return Les vendeurs de la liste, dans l'ordre où ils ont été sauvegardés
+     */
+    std::vector<Seller*> getSellers(CheckpointList list) const;
+
+private:
+    void* mapping;
+    size_t mappingSize;
+    const CheckpointHeader* header;
+    const CheckpointRecord* records;
+    const uint32_t* ids;
+    std::map<int, Seller*> sellers;
+};
+
+#endif // CHECKPOINT_H
@@ -1,29 +1,41 @@
 #include "clinic.h"
+#include "hospital.h"
+#include "trace.h"
+#include "conservationAuditor.h"
+#include "transactionLog.h"
+#include "checkpoint.h"
+#include "placement.h"
 #include "costs.h"
 #include <pcosynchro/pcothread.h>
 #include <iostream>
 
 Clinic::Clinic(int uniqueId, int fund, std::vector<ItemType> resourcesNeeded)
     : SellerMutex(fund, uniqueId),
+    resourcesNeeded(resourcesNeeded),
     nbTreated(0),
-    resourcesNeeded(resourcesNeeded)
+    nextSubscriber(0)
 {
     lockMutex();
     for(const auto& item : resourcesNeeded) {
         stocks[item] = 0;
     }
+    // Created up front, so a concurrent request never inserts into stocks while the clinic reads it
+    stocks[ItemType::PatientHealed] = 0;
     unlockMutex();
 
     updateWithMessage("Clinic Created");
 }
 
 bool Clinic::verifyResources() {
+    TraceSpan span("verifyResources", uniqueId);
+
+    lockMutex();
     for (auto item : resourcesNeeded) {
         if (stocks[item] <= 0) {
+            unlockMutex();
             return false;
         }
     }
-    lockMutex();
     if(money < getTreatmentCost()) {
         unlockMutex();
 
@@ -31,32 +43,51 @@ bool Clinic::verifyResources() {
         return false;
     }
     money -= getTreatmentCost();
+    ConservationAuditor::record(AuditQuantity::Funds, -getTreatmentCost());
     unlockMutex();
     return true;
 }
 
 int Clinic::request(ItemType what, int qty) {
-    if (what == ItemType::PatientHealed && qty > 0) {
-        int benefit = getCostPerUnit(ItemType::PatientHealed) * qty;
-        lockMutex();
-        if(stocks[ItemType::PatientHealed] >= qty) {
-            stocks[ItemType::PatientHealed] -= qty;
-            money += benefit;
-            unlockMutex();
-
-            updateWithMessage("Provided " + QString::number(qty) + " healed patient" + (qty > 1 ? "s" : ""));
+    ScopedLatency latency(latencies, SellerOperation::Request);
+    TraceSpan span("request", uniqueId);
 
-            return benefit;
-        }
+    lockMutex();
+    if (canSell(what, qty)) {
+        int benefit = sell(what, qty);
         unlockMutex();
+
+        updateWithMessage("Provided " + QString::number(qty) + " healed patient" + (qty > 1 ? "s" : ""));
+
+        return benefit;
     }
+    unlockMutex();
 
+    countTrade(false);
     interfaceMessage("Refused request for " + QString::number(qty) + " " + getItemName(what));
 
     return 0;
 }
 
+bool Clinic::canSell(ItemType what, int qty) {
+    return what == ItemType::PatientHealed && qty > 0 && stocks[ItemType::PatientHealed] >= qty;
+}
+
+int Clinic::sell(ItemType what, int qty) {
+    int benefit = getCostPerUnit(ItemType::PatientHealed) * qty;
+    stocks[ItemType::PatientHealed] -= qty;
+    givePatients(ItemType::PatientHealed, qty);
+    money += benefit;
+    ConservationAuditor::record(AuditQuantity::Patients, -qty);
+    ConservationAuditor::record(AuditQuantity::Funds, benefit);
+    TransactionLog::append(TransactionKind::Sale, uniqueId, static_cast<int>(what), qty, benefit, money);
+    countTrade(true);
+    return benefit;
+}
+
 void Clinic::treatPatient() {
+    TraceSpan span("treatPatient", uniqueId);
+
     int cost = getTreatmentCost();
     lockMutex();
     for(auto resource : resourcesNeeded) {
@@ -70,27 +101,71 @@ void Clinic::treatPatient() {
     simulateWork();
 
     lockMutex();
-    ++nbTreated;
+    nbTreated.fetch_add(1, std::memory_order_relaxed);
+    ConservationAuditor::record(AuditQuantity::Paid, getEmployeeSalary(getEmployeeThatProduces(ItemType::PatientHealed)));
     stocks[ItemType::PatientHealed] += 1;
     stocks[ItemType::PatientSick] -= 1;
+    PatientId patient = PatientTracker::UNTRACKED;
+    if(!sickPatientIds.empty()) {
+        patient = sickPatientIds.front();
+        sickPatientIds.pop_front();
+    }
+    PatientTracker::stamp(patient, PatientStage::Healed);
+    healedPatientIds.push_back(patient);
+    TransactionLog::append(TransactionKind::Treatment, uniqueId, static_cast<int>(ItemType::PatientHealed), 1, -cost, money);
     unlockMutex();
 
+    Hospital* subscriber = nullptr;
+    {
+        RcuReadScope scope;
+        const std::vector<Seller*>& notified = subscribers.read();
+        if(!notified.empty()) {
+            // The list may have shrunk since the last notification
+            subscriber = static_cast<Hospital*>(notified[nextSubscriber % notified.size()]);
+            nextSubscriber = (nextSubscriber + 1) % notified.size();
+        }
+    }
+    if(subscriber) {
+        ReplayTurn notify(ReplayOp::Notify);
+        subscriber->notifyHealedPatientReady(this);
+    }
+
     updateWithMessage("Treated a patient");
 }
 
 void Clinic::orderResources() {
+    TraceSpan span("orderResources", uniqueId);
+
+    std::vector<BundleItem> bundle;
+
+    std::vector<ItemType> missing;
+    lockMutex();
     for(auto resource : resourcesNeeded) {
         if(stocks[resource] == 0 && resource != ItemType::PatientHealed) {
-            std::vector<Seller*> sellers = resource == ItemType::PatientSick ? hospitals : suppliers;
+            missing.push_back(resource);
+        }
+    }
+    unlockMutex();
 
-            int qty = buyFromSellers(sellers, resource, MAX_ITEMS_PER_ORDER);
+    for(auto resource : missing) {
+        Seller* seller;
+        {
+            RcuReadScope scope;
+            const std::vector<Seller*>& sellers = resource == ItemType::PatientSick ? hospitals.read() : suppliers.read();
+            seller = Seller::chooseRandomSellerWith(sellers, resource, MAX_ITEMS_PER_ORDER, region);
+        }
 
-            if(qty > 0) {
-                updateWithMessage("Bought " + QString::number(qty) + " " + getItemName(resource) + " from supplier" + (suppliers.size() > 1 ? "s" : ""));
-            } else {
-                interfaceMessage("No stock of " + getItemName(resource) + " in " + QString::number(MAX_ITEMS_PER_ORDER) + " quantity available from supplier" + (suppliers.size() > 1 ? "s" : ""));
-            }
-        } 
+        if(!seller) {
+            interfaceMessage("No stock of " + getItemName(resource) + " in " + QString::number(MAX_ITEMS_PER_ORDER) + " quantity available from " + (resource == ItemType::PatientSick ? "hospitals" : "suppliers"));
+            return;
+        }
+
+        bundle.push_back({seller, resource, MAX_ITEMS_PER_ORDER});
+    }
+
+    // The whole recipe is bought at once, so the clinic never holds a partial recipe
+    if(!bundle.empty() && buyBundleFromSellers(bundle)) {
+        updateWithMessage("Bought the " + QString::number(bundle.size()) + " missing resource" + (bundle.size() > 1 ? "s" : "") + " for a treatment");
     }
 }
 
@@ -101,9 +176,13 @@ void Clinic::run() {
     }
 
     interfaceMessage("[START] Factory routine");
+    Trace::setActorName(uniqueId, QString("Clinic %1").arg(uniqueId));
+    Replay::setActor(uniqueId);
+    Placement::apply(uniqueId);
+
+    while (!isFinished()) {
+        AuditScope audit;
 
-    while (!finished) {
-        
         if (verifyResources()) {
             treatPatient();
         } else {
@@ -129,28 +208,66 @@ void Clinic::setHospitalsAndSuppliers(std::vector<Seller*> hospitals, std::vecto
     }
 }
 
+void Clinic::addHospital(Seller* hospital) {
+    if (hospitals.add(hospital)) {
+        setLink(hospital->getUniqueId());
+    }
+}
+
+void Clinic::addSupplier(Seller* supplier) {
+    if (suppliers.add(supplier)) {
+        setLink(supplier->getUniqueId());
+    }
+}
+
+void Clinic::removeSupplier(Seller* supplier) {
+    suppliers.remove(supplier);
+}
+
+void Clinic::drain() {
+    hospitals = std::vector<Seller*>();
+}
+
+std::vector<Seller*> Clinic::getTradingPartners() {
+    RcuReadScope scope;
+    std::vector<Seller*> partners = hospitals.read();
+    // Both iterators must come from the same published list, a writer may swap it between two reads
+    const auto& list = suppliers.read();
+    partners.insert(partners.end(), list.begin(), list.end());
+    return partners;
+}
+
+void Clinic::subscribeHealedPatients(Hospital* hospital) {
+    subscribers.add(hospital);
+}
+
 int Clinic::getTreatmentCost() {
     return getEmployeeSalary(getEmployeeThatProduces(ItemType::PatientHealed));
 }
 
 int Clinic::getWaitingPatients() {
-    return stocks[ItemType::PatientSick];
+    return getSnapshot().getStock(ItemType::PatientSick);
 }
 
 int Clinic::getNumberPatients(){
-    return stocks[ItemType::PatientSick] + stocks[ItemType::PatientHealed];
+    SellerSnapshot snapshot = getSnapshot();
+    return snapshot.getStock(ItemType::PatientSick) + snapshot.getStock(ItemType::PatientHealed);
 }
 
 int Clinic::send(ItemType it, int qty, int bill){
     return 0;
 }
 
+int Clinic::getNumberTreated() {
+    return nbTreated.load(std::memory_order_relaxed);
+}
+
 int Clinic::getAmountPaidToWorkers() {
-    return nbTreated * getEmployeeSalary(getEmployeeThatProduces(ItemType::PatientHealed));
+    return nbTreated.load(std::memory_order_relaxed) * getEmployeeSalary(getEmployeeThatProduces(ItemType::PatientHealed));
 }
 
 std::map<ItemType, int> Clinic::getItemsForSale() {
-    return stocks;
+    return getSnapshot().toMap();
 }
 
 
@@ -162,3 +279,28 @@ Cardiology::Cardiology(int uniqueId, int fund) :
 
 Neurology::Neurology(int uniqueId, int fund) :
     Clinic::Clinic(uniqueId, fund, {ItemType::PatientSick, ItemType::Pill, ItemType::Scalpel}) {}
+
+void Clinic::saveState(CheckpointRecord& record, CheckpointWriter& writer) {
+    Seller::saveState(record, writer);
+    record.counters[0] = nbTreated.load(std::memory_order_relaxed);
+    record.counters[1] = static_cast<int>(nextSubscriber);
+    record.lists[0] = writer.addList(suppliers.copy());
+    record.lists[1] = writer.addList(hospitals.copy());
+    record.lists[2] = writer.addList(subscribers.copy());
+}
+
+void Clinic::restoreState(const CheckpointRecord& record, const CheckpointReader& checkpoint) {
+    Seller::restoreState(record, checkpoint);
+    nbTreated.store(record.counters[0], std::memory_order_relaxed);
+    suppliers = checkpoint.getSellers(record.lists[0]);
+    hospitals = checkpoint.getSellers(record.lists[1]);
+    std::vector<Seller*> hospitalSubscribers;
+    for (Seller* subscriber : checkpoint.getSellers(record.lists[2])) {
+        if (dynamic_cast<Hospital*>(subscriber)) {
+            hospitalSubscribers.push_back(subscriber);
+        }
+    }
+    nextSubscriber = hospitalSubscribers.empty() ? 0 : static_cast<size_t>(record.counters[1]) % hospitalSubscribers.size();
+    subscribers = std::move(hospitalSubscribers);
+    updateInterface();
+}
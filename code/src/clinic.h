@@ -4,6 +4,9 @@
 #include <vector>
 
 #include "sellerMutex.h"
+#include "sellerList.h"
+
+class Hospital;
 
 #define MAX_PATIENTS_PER_TREATMENT 1
 #define MAX_ITEMS_PER_ORDER 1
@@ -74,25 +77,95 @@ public:
      */
     void setHospitalsAndSuppliers(std::vector<Seller*> hospitals, std::vector<Seller*> suppliers);
 
+    /**
+     * @brief addHospital
+     * @param hospital Hôpital auquel la clinique achètera aussi des patients malades, peut être appelée pendant la simulation
+     */
+    void addHospital(Seller* hospital);
+
+    /**
+     * @brief addSupplier
+     * @param supplier Fournisseur auquel la clinique achètera aussi des ressources, peut être appelée pendant la simulation
+     */
+    void addSupplier(Seller* supplier);
+
+    /**
+     * @brief removeSupplier
+     * @param supplier Fournisseur auquel la clinique n'achète plus rien, peut être appelée pendant la simulation
+     * Un achat déjà engagé avec ce fournisseur se termine normalement.
+     */
+    void removeSupplier(Seller* supplier);
+
+    /**
+     * @brief drain
+     * La clinique n'achète plus de patients malades : elle soigne ceux qu'elle a et continue de céder les patients soignés
+     */
+    void drain();
+
+    /**
+     * @brief getTradingPartners
+     * @return Les hôpitaux et les fournisseurs de la clinique
+     */
+    std::vector<Seller*> getTradingPartners() override;
+
+    /**
+     * @brief subscribeHealedPatients
+     * @param hospital Hôpital à notifier lorsqu'un patient soigné est prêt à être transféré
+     * Les patients soignés sont annoncés aux hôpitaux abonnés à tour de rôle. Peut être appelée pendant la simulation.
+     */
+    void subscribeHealedPatients(Hospital* hospital);
+
     int getNumberPatients();
 
+    /**
+     * @brief getNumberTreated
+     * @return Le nombre total de patients traités par la clinique
+     */
+    int getNumberTreated();
+
     /**
      * @brief getAmountPaidToWorkers
      * @return Le montant total payé aux travailleurs de la clinique.
      */
     int getAmountPaidToWorkers();
 
+    /**
+     * @brief saveState
+     * Sauvegarde aussi le nombre de patients traités, les fournisseurs, hôpitaux et abonnés liés et le prochain abonné notifié
+     */
+    void saveState(CheckpointRecord& record, CheckpointWriter& writer) override;
+
+    void restoreState(const CheckpointRecord& record, const CheckpointReader& checkpoint) override;
+
+protected:
+    /**
+     * @brief canSell
+     * @return true si la clinique a assez de patients soignés à céder, le mutex doit être verrouillé
+     */
+    bool canSell(ItemType what, int qty) override;
+
+    /**
+     * @brief sell
+     * Cède les patients soignés, le mutex doit être verrouillé
+     * @return La facture de la vente
+     */
+    int sell(ItemType what, int qty) override;
+
 private:
-    std::vector<Seller*> suppliers;    // Liste des fournisseurs de ressources nécessaires à la clinique
-    std::vector<Seller*> hospitals;     // Liste des hôpitaux associés à la clinique
+    SellerList suppliers;               // Liste des fournisseurs de ressources nécessaires à la clinique
+    SellerList hospitals;               // Liste des hôpitaux associés à la clinique
 
     const std::vector<ItemType> resourcesNeeded; // Liste des ressources requises pour le fonctionnement de la clinique
 
-    int nbTreated;                      // Nombre total de patients traités par la clinique
+    std::atomic<int> nbTreated;         // Nombre total de patients traités par la clinique
+
+    SellerList subscribers;             // Hôpitaux notifiés des patients soignés
+    size_t nextSubscriber;              // Prochain hôpital à notifier
 
     /**
      * @brief orderResources
      * Fonction pour acheter des ressources nécessaires au traitement des patients chez les fournisseurs.
+     * Toutes les ressources manquantes sont achetées en une seule commande groupée, ou aucune.
      */
     void orderResources();
 
@@ -0,0 +1,151 @@
+#include "conservationAuditor.h"
+#include <chrono>
+#include <vector>
+#include <pcosynchro/pcomutex.h>
+#include <pcosynchro/pcothread.h>
+
+namespace {
+
+const int NB_QUANTITIES = static_cast<int>(AuditQuantity::NbQuantities);
+
+struct DeltaBlock {
+    std::atomic<uint32_t> sequence{0};          // Impair pendant une publication
+    std::atomic<int64_t> committed[NB_QUANTITIES] = {};
+    int64_t pending[NB_QUANTITIES] = {};        // Accédé uniquement par le thread propriétaire
+    int depth = 0;
+};
+
+PcoMutex registryMutex;                         // Protège uniquement l'enregistrement des blocs
+std::vector<DeltaBlock*> blocks;
+
+DeltaBlock& threadBlock() {
+    // The block outlives its thread so that its deltas keep counting in the totals
+    thread_local DeltaBlock* block = nullptr;
+    if (!block) {
+        block = new DeltaBlock();
+        registryMutex.lock();
+        blocks.push_back(block);
+        registryMutex.unlock();
+    }
+    return *block;
+}
+
+void publish(DeltaBlock& block) {
+    uint32_t sequence = block.sequence.load(std::memory_order_relaxed);
+    block.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (int i = 0; i < NB_QUANTITIES; ++i) {
+        if (block.pending[i] != 0) {
+            block.committed[i].store(block.committed[i].load(std::memory_order_relaxed) + block.pending[i], std::memory_order_relaxed);
+            block.pending[i] = 0;
+        }
+    }
+    block.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void readBlock(const DeltaBlock& block, int64_t (&values)[NB_QUANTITIES]) {
+    uint32_t before, after;
+    do {
+        before = block.sequence.load(std::memory_order_acquire);
+        for (int i = 0; i < NB_QUANTITIES; ++i) {
+            values[i] = block.committed[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = block.sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
+
+void readTotals(int64_t (&totals)[NB_QUANTITIES]) {
+    for (auto& total : totals) {
+        total = 0;
+    }
+    registryMutex.lock();
+    std::vector<DeltaBlock*> snapshot = blocks;
+    registryMutex.unlock();
+
+    for (DeltaBlock* block : snapshot) {
+        int64_t values[NB_QUANTITIES];
+        readBlock(*block, values);
+        for (int i = 0; i < NB_QUANTITIES; ++i) {
+            totals[i] += values[i];
+        }
+    }
+}
+
+int64_t at(const int64_t (&totals)[NB_QUANTITIES], AuditQuantity quantity) {
+    return totals[static_cast<int>(quantity)];
+}
+
+const auto auditStart = std::chrono::steady_clock::now();
+
+}
+
+AuditScope::AuditScope() {
+    ++threadBlock().depth;
+}
+
+AuditScope::~AuditScope() {
+    DeltaBlock& block = threadBlock();
+    if (--block.depth == 0) {
+        publish(block);
+    }
+}
+
+void ConservationAuditor::record(AuditQuantity quantity, int64_t delta) {
+    threadBlock().pending[static_cast<int>(quantity)] += delta;
+}
+
+int64_t ConservationAuditor::getTotal(AuditQuantity quantity) {
+    int64_t totals[NB_QUANTITIES];
+    readTotals(totals);
+    return at(totals, quantity);
+}
+
+ConservationAuditor::ConservationAuditor(int periodMs)
+    : periodMs(periodMs), finished(false), nbChecks(0), nbViolations(0),
+      firstViolationMs(0), firstFundsImbalance(0), firstPatientsImbalance(0) {}
+
+void ConservationAuditor::setFinished() {
+    finished.store(true, std::memory_order_relaxed);
+}
+
+bool ConservationAuditor::check() {
+    int64_t totals[NB_QUANTITIES];
+    readTotals(totals);
+
+    int64_t funds = at(totals, AuditQuantity::Funds) + at(totals, AuditQuantity::Paid) - at(totals, AuditQuantity::Income);
+    int64_t patients = at(totals, AuditQuantity::Patients) - at(totals, AuditQuantity::Arrivals);
+
+    nbChecks.fetch_add(1, std::memory_order_relaxed);
+    if (funds == 0 && patients == 0) {
+        return true;
+    }
+
+    if (nbViolations.fetch_add(1, std::memory_order_relaxed) == 0) {
+        firstViolationMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - auditStart).count();
+        firstFundsImbalance = funds;
+        firstPatientsImbalance = patients;
+    }
+    return false;
+}
+
+void ConservationAuditor::run() {
+    while (!finished.load(std::memory_order_relaxed)) {
+        check();
+        PcoThread::usleep(periodMs * 1000);
+    }
+    check();
+}
+
+QString ConservationAuditor::report() {
+    QString report = QString("Conservation audit : %1 checks, %2 violations")
+                         .arg(static_cast<unsigned long long>(nbChecks.load(std::memory_order_relaxed)))
+                         .arg(static_cast<unsigned long long>(getNbViolations()));
+    if (getNbViolations() > 0) {
+        report += QString(" (first after %1 ms : funds off by %2, patients off by %3)")
+                      .arg(firstViolationMs, 0, 'f', 1)
+                      .arg(static_cast<long long>(firstFundsImbalance))
+                      .arg(static_cast<long long>(firstPatientsImbalance));
+    }
+    return report;
+}
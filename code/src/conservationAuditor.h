@@ -0,0 +1,88 @@
+#ifndef CONSERVATIONAUDITOR_H
+#define CONSERVATIONAUDITOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <QString>
+
+/**
+ * @brief Grandeurs suivies par l'auditeur
+ * Funds : variation de l'argent des vendeurs, Paid : argent versé aux employés, Income : argent entrant dans la simulation,
+ * Patients : variation du nombre de patients des vendeurs, Arrivals : patients entrant dans la simulation
+ */
+enum class AuditQuantity { Funds, Paid, Income, Patients, Arrivals, NbQuantities };
+
+/**
+ * @brief The AuditScope class
+ * Délimite une suite de modifications qui, ensemble, conservent l'argent et les patients (un tour de boucle d'une entité).
+ * Les variations enregistrées dans le thread restent privées jusqu'à la sortie de la portée la plus externe,
+ * puis sont publiées d'un coup ; l'auditeur ne voit donc jamais un échange à moitié effectué.
+ */
+class AuditScope {
+public:
+    AuditScope();
+    ~AuditScope();
+};
+
+/**
+ * @brief The ConservationAuditor class
+ * Vérifie en continu que l'argent et les patients sont conservés, sans parcourir les entités :
+ * chaque thread cumule ses variations dans un bloc qui lui est propre, publié sous un seqlock à la sortie de son AuditScope.
+ * L'auditeur additionne les blocs publiés à chaque tick et signale tout déséquilibre :
+ * Funds + Paid - Income et Patients - Arrivals doivent rester nuls.
+ */
+class ConservationAuditor {
+public:
+    /**
+     * @brief record
+     * @param quantity La grandeur modifiée
+     * @param delta La variation, publiée à la fin de l'AuditScope courant du thread
+     */
+    static void record(AuditQuantity quantity, int64_t delta);
+
+    /**
+     * @brief ConservationAuditor
+     * @param periodMs Intervalle entre deux vérifications
+     */
+    explicit ConservationAuditor(int periodMs);
+
+    /**
+     * @brief run
+     * Vérifie les invariants à chaque tick jusqu'à setFinished(), puis une dernière fois
+     */
+    void run();
+
+    void setFinished();
+
+    /**
+     * @brief check
+     * @return true si les variations publiées par tous les threads sont équilibrées
+     */
+    bool check();
+
+    /**
+     * @brief getTotal
+     * @param quantity La grandeur demandée
+     * @return La somme des variations publiées par tous les threads
+     */
+    static int64_t getTotal(AuditQuantity quantity);
+
+    uint64_t getNbViolations() const { return nbViolations.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief report
+     * @return Le nombre de vérifications, de violations et le premier déséquilibre constaté
+     */
+    QString report();
+
+private:
+    int periodMs;
+    std::atomic<bool> finished;
+    std::atomic<uint64_t> nbChecks;
+    std::atomic<uint64_t> nbViolations;
+    double firstViolationMs;
+    int64_t firstFundsImbalance;
+    int64_t firstPatientsImbalance;
+};
+
+#endif // CONSERVATIONAUDITOR_H
@@ -1,6 +1,14 @@
 #include "hospital.h"
+#include "clinic.h"
+#include "trace.h"
+#include "conservationAuditor.h"
+#include "transactionLog.h"
+#include "checkpoint.h"
+#include "placement.h"
 #include "costs.h"
 #include <iostream>
+#include <algorithm>
+#include <chrono>
 #include <pcosynchro/pcothread.h>
 
 Hospital::Hospital(int uniqueId, int fund, int maxBeds)
@@ -9,7 +17,8 @@ Hospital::Hospital(int uniqueId, int fund, int maxBeds)
       currentBeds(0),
       nbHospitalised(0),
       nbFree(0),
-      healedPatientsQueue({0})
+      healedPatientsQueue({0}),
+      nextAdmissionTicket(0)
 {    
     lockMutex();
     std::vector<ItemType> initialStocks = { ItemType::PatientHealed, ItemType::PatientSick };
@@ -31,106 +40,231 @@ int& Hospital::getNumberHealed() {
 }
 
 int Hospital::request(ItemType what, int qty){
-    if (what == ItemType::PatientSick && qty > 0) {
-        static int patientCost = getCostPerUnit(ItemType::PatientSick);
-        int totalBenefit = qty * patientCost;
-        lockMutex();
-        if(getNumberSick() >= qty) {
-            getNumberSick() -= qty;
-            currentBeds -= qty;
-            money += totalBenefit;
-            unlockMutex();
+    ScopedLatency latency(latencies, SellerOperation::Request);
+    TraceSpan span("request", uniqueId);
 
-            updateWithMessage("Provided " + QString::number(qty) + " sick patient" + (qty > 1 ? "s" : ""));
-
-            return totalBenefit;
-        }
+    lockMutex();
+    if (canSell(what, qty)) {
+        int totalBenefit = sell(what, qty);
         unlockMutex();
+
+        updateWithMessage("Provided " + QString::number(qty) + " sick patient" + (qty > 1 ? "s" : ""));
+
+        return totalBenefit;
     }
-    
+    unlockMutex();
+
+    countTrade(false);
     interfaceMessage("Refused request for " + QString::number(qty) + " " + getItemName(what));
     return 0;
 }
 
+bool Hospital::canSell(ItemType what, int qty) {
+    return what == ItemType::PatientSick && qty > 0 && getNumberSick() >= qty;
+}
+
+int Hospital::sell(ItemType what, int qty) {
+    static int patientCost = getCostPerUnit(ItemType::PatientSick);
+    int totalBenefit = qty * patientCost;
+    getNumberSick() -= qty;
+    givePatients(ItemType::PatientSick, qty);
+    currentBeds -= qty;
+    money += totalBenefit;
+    ConservationAuditor::record(AuditQuantity::Patients, -qty);
+    ConservationAuditor::record(AuditQuantity::Funds, totalBenefit);
+    TransactionLog::append(TransactionKind::Sale, uniqueId, static_cast<int>(what), qty, totalBenefit, money);
+    countTrade(true);
+    admissionCondition.notifyAll();
+    return totalBenefit;
+}
+
 void Hospital::freeHealedPatient() {
+    TraceSpan span("freeHealedPatient", uniqueId);
+
     lockMutex();
     int nbLetGo = healedPatientsQueue[0];
     nbFree += nbLetGo;
     getNumberHealed() -= nbLetGo;
+    for(int i = 0; i < nbLetGo && !healedPatientIds.empty(); ++i) {
+        PatientTracker::stamp(healedPatientIds.front(), PatientStage::Discharged);
+        healedPatientIds.pop_front();
+    }
     currentBeds -= nbLetGo;
     money += nbLetGo * BENEFIT_OF_HEALING;
+    ConservationAuditor::record(AuditQuantity::Funds, nbLetGo * BENEFIT_OF_HEALING);
+    ConservationAuditor::record(AuditQuantity::Income, nbLetGo * BENEFIT_OF_HEALING);
+    if (nbLetGo > 0) {
+        TransactionLog::append(TransactionKind::Discharge, uniqueId, static_cast<int>(ItemType::PatientHealed), nbLetGo, nbLetGo * BENEFIT_OF_HEALING, money);
+    }
     for(int i = 0; i < NB_DAYS_OF_REST - 1; ++i) {
         healedPatientsQueue[i] = healedPatientsQueue[i+1];
     }
     healedPatientsQueue[NB_DAYS_OF_REST - 1] = 0;
+    if (nbLetGo > 0) {
+        admissionCondition.notifyAll();
+    }
     unlockMutex();
 
     updateWithMessage("Let go " + QString::number(nbLetGo) + " healed patient" + (nbLetGo > 1 ? "s" : ""));
 }
 
 void Hospital::transferPatientsFromClinic() {
+    TraceSpan span("transferPatientsFromClinic", uniqueId);
+
     static int employeeSalary = getEmployeeSalary(EmployeeType::Nurse);
     static int costPerHealed = getCostPerUnit(ItemType::PatientHealed);
     static int transferCost = costPerHealed + employeeSalary;
 
-    int qtyReserved = 0;
+    int qty = 0;
 
-    lockMutex();
-    if (currentBeds < maxBeds) {
-        qtyReserved = maxBeds - currentBeds;
-        qtyReserved = qtyReserved / 2 + qtyReserved % 2;
-        currentBeds += qtyReserved;
-    }
-    unlockMutex();
-
-    if (qtyReserved == 0) {
-        return;
-    }
-
-    int qty = buyFromSellers(clinics, ItemType::PatientHealed, qtyReserved, transferCost);
+    while (true) {
+        Seller* clinic = nullptr;
 
-    if (qty > 0) {
+        // A notification is only claimed once a bed and the transfer money are reserved for it
         lockMutex();
-        currentBeds += qty - qtyReserved;
-        nbHospitalised += qty;
-        healedPatientsQueue[NB_DAYS_OF_REST - 1] += qty;
+        if (currentBeds >= maxBeds || money < transferCost || !healedPatientsReady.pop(clinic)) {
+            unlockMutex();
+            break;
+        }
+        currentBeds += 1;
+        money -= transferCost;
+        ConservationAuditor::record(AuditQuantity::Funds, -transferCost);
         unlockMutex();
 
-        updateWithMessage("Transferred " + QString::number(qty) + " patient" + (qty > 1 ? "s" : "") + " from clinic" + (clinics.size() > 1 ? "s" : ""));
-    } else {
-        lockMutex();
-        currentBeds -= qtyReserved;
-        unlockMutex();
-        interfaceMessage("No healed patient available at clinic(s)");
+        if (buyFromSeller(clinic, ItemType::PatientHealed, 1, transferCost)) {
+            lockMutex();
+            nbHospitalised.fetch_add(1, std::memory_order_relaxed);
+            ConservationAuditor::record(AuditQuantity::Paid, employeeSalary);
+            healedPatientsQueue[NB_DAYS_OF_REST - 1] += 1;
+            unlockMutex();
 
+            ++qty;
+        } else {
+            lockMutex();
+            currentBeds -= 1;
+            admissionCondition.notifyAll();
+            unlockMutex();
+        }
+    }
+
+    if (qty > 0) {
+        updateWithMessage("Transferred " + QString::number(qty) + " patient" + (qty > 1 ? "s" : "") + " from clinic" + (clinics.size() > 1 ? "s" : ""));
     }
 }
 
+void Hospital::notifyHealedPatientReady(Seller* clinic) {
+    healedPatientsReady.push(clinic);
+}
+
 int Hospital::send(ItemType it, int qty, int bill) {
+    ScopedLatency latency(latencies, SellerOperation::Send);
+    TraceSpan span("send", uniqueId);
+
     if(it == ItemType::PatientSick && qty > 0) {
         static int employeeSalary = getEmployeeSalary(EmployeeType::Nurse);
-        int totalCost = qty * employeeSalary + bill;
+        int costPerPatient = employeeSalary + bill / qty;
         lockMutex();
-        if (money >= totalCost && qty <= (maxBeds - currentBeds)) {
-
-            getNumberSick() += qty;
-            currentBeds += qty;
-            money -= totalCost;
-            nbHospitalised += qty;
+        // Ambulances already waiting for a bed are served first
+        int accepted = admissionQueue.empty() ? getAdmissibleQuantity(qty, costPerPatient) : 0;
+        if (accepted > 0) {
+            admit(accepted, costPerPatient);
             unlockMutex();
 
-            updateWithMessage("Received " + QString::number(qty) + " sick patient(s)");
+            updateWithMessage("Received " + QString::number(accepted) + " sick patient(s)");
 
-            return qty;
+            return accepted;
         }
         unlockMutex();
     }
 
+    countTrade(false);
     interfaceMessage(QString("Refused request for " + QString::number(qty) + " " + getItemName(it)));
 
     return 0;
 }
 
+int Hospital::sendBlocking(ItemType it, int qty, int bill, int timeoutSeconds) {
+    ScopedLatency latency(latencies, SellerOperation::Admission);
+    TraceSpan span("sendBlocking", uniqueId);
+
+    // A wait depends on the other threads' timing and could not be replayed, admissions are immediate instead
+    if(it != ItemType::PatientSick || qty <= 0 || Replay::isActive()) {
+        return send(it, qty, bill);
+    }
+
+    static int employeeSalary = getEmployeeSalary(EmployeeType::Nurse);
+    int costPerPatient = employeeSalary + bill / qty;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeoutSeconds);
+
+    lockMutex();
+    unsigned long ticket = nextAdmissionTicket++;
+    admissionQueue.push_back(ticket);
+
+    while (!finished && !(admissionQueue.front() == ticket && getAdmissibleQuantity(qty, costPerPatient) > 0)) {
+        auto remaining = std::chrono::ceil<std::chrono::seconds>(deadline - std::chrono::steady_clock::now());
+        if (remaining.count() <= 0 || !waitMutex(admissionCondition, static_cast<int>(remaining.count()))) {
+            break;
+        }
+    }
+
+    int accepted = (!finished && admissionQueue.front() == ticket) ? getAdmissibleQuantity(qty, costPerPatient) : 0;
+    admissionQueue.erase(std::find(admissionQueue.begin(), admissionQueue.end(), ticket));
+    if (accepted > 0) {
+        admit(accepted, costPerPatient);
+    }
+    // The next ambulance in line may be admissible now that this one left the queue
+    admissionCondition.notifyAll();
+    unlockMutex();
+
+    if (accepted == 0) {
+        countTrade(false);
+        interfaceMessage(QString("Refused request for " + QString::number(qty) + " " + getItemName(it) + " after waiting for a bed"));
+        return 0;
+    }
+
+    updateWithMessage("Received " + QString::number(accepted) + " sick patient(s)");
+
+    return accepted;
+}
+
+int Hospital::getAdmissionCapacity(ItemType what) {
+    if (what != ItemType::PatientSick) {
+        return 0;
+    }
+
+    static int costPerPatient = getEmployeeSalary(EmployeeType::Nurse) + getCostPerUnit(ItemType::PatientSick);
+    lockMutex();
+    int capacity = getAdmissibleQuantity(maxBeds, costPerPatient);
+    unlockMutex();
+
+    return capacity;
+}
+
+int Hospital::getAdmissibleQuantity(int qty, int costPerPatient) {
+    int affordable = costPerPatient > 0 ? money / costPerPatient : qty;
+    return std::max(0, std::min({qty, maxBeds - currentBeds, affordable}));
+}
+
+void Hospital::admit(int qty, int costPerPatient) {
+    getNumberSick() += qty;
+    receivePatients(ItemType::PatientSick, qty, PatientStage::Admitted);
+    currentBeds += qty;
+    money -= qty * costPerPatient;
+    nbHospitalised.fetch_add(qty, std::memory_order_relaxed);
+    ConservationAuditor::record(AuditQuantity::Patients, qty);
+    ConservationAuditor::record(AuditQuantity::Funds, -qty * costPerPatient);
+    ConservationAuditor::record(AuditQuantity::Paid, qty * getEmployeeSalary(EmployeeType::Nurse));
+    TransactionLog::append(TransactionKind::Admission, uniqueId, static_cast<int>(ItemType::PatientSick), qty, -qty * costPerPatient, money);
+    countTrade(true);
+}
+
+void Hospital::setFinished() {
+    lockMutex();
+    Seller::setFinished();
+    admissionCondition.notifyAll();
+    unlockMutex();
+}
+
 void Hospital::run()
 {
     if (clinics.empty()) {
@@ -139,13 +273,21 @@ void Hospital::run()
     }
 
     interfaceMessage("[START] Hospital routine");
+    Trace::setActorName(uniqueId, QString("Hospital %1").arg(uniqueId));
+    Replay::setActor(uniqueId);
+    Placement::apply(uniqueId);
+
+    while (!isFinished()) {
+        AuditScope audit;
 
-    while (!finished) {
         transferPatientsFromClinic();
 
         freeHealedPatient();
 
-        updateInterface();
+        {
+            TraceSpan span("updateInterface", uniqueId);
+            updateInterface();
+        }
 
         simulateWork();
     }
@@ -154,16 +296,31 @@ void Hospital::run()
 }
 
 int Hospital::getAmountPaidToWorkers() {
-    return nbHospitalised * getEmployeeSalary(EmployeeType::Nurse);
+    return nbHospitalised.load(std::memory_order_relaxed) * getEmployeeSalary(EmployeeType::Nurse);
 }
 
 int Hospital::getNumberPatients(){
-    return getNumberSick() + getNumberHealed() + nbFree;
+    SellerSnapshot snapshot = getSnapshot();
+    return snapshot.getStock(ItemType::PatientSick) + snapshot.getStock(ItemType::PatientHealed) + getNumberDischarged();
+}
+
+int Hospital::getNumberDischarged() {
+    lockMutex();
+    int discharged = nbFree;
+    unlockMutex();
+    return discharged;
+}
+
+int Hospital::getOccupiedBeds() {
+    lockMutex();
+    int occupied = currentBeds;
+    unlockMutex();
+    return occupied;
 }
 
 std::map<ItemType, int> Hospital::getItemsForSale()
 {
-    return stocks;
+    return getSnapshot().toMap();
 }
 
 void Hospital::setClinics(std::vector<Seller*> clinics){
@@ -171,9 +328,65 @@ void Hospital::setClinics(std::vector<Seller*> clinics){
 
     for (Seller* clinic : clinics) {
         setLink(clinic->getUniqueId());
+
+        if (Clinic* healingClinic = dynamic_cast<Clinic*>(clinic)) {
+            healingClinic->subscribeHealedPatients(this);
+        }
     }
 }
 
+void Hospital::addClinic(Seller* clinic) {
+    if (!clinics.add(clinic)) {
+        return;
+    }
+    setLink(clinic->getUniqueId());
+    if (Clinic* healingClinic = dynamic_cast<Clinic*>(clinic)) {
+        healingClinic->subscribeHealedPatients(this);
+    }
+}
+
+std::vector<Seller*> Hospital::getTradingPartners() {
+    return clinics.copy();
+}
+
 int Hospital::getFundingFromHealed() {
-    return nbFree * BENEFIT_OF_HEALING;
+    return getNumberDischarged() * BENEFIT_OF_HEALING;
+}
+
+void Hospital::saveState(CheckpointRecord& record, CheckpointWriter& writer) {
+    Seller::saveState(record, writer);
+    record.counters[0] = maxBeds;
+    record.counters[1] = currentBeds;
+    record.counters[2] = nbHospitalised.load(std::memory_order_relaxed);
+    record.counters[3] = nbFree;
+    std::copy(healedPatientsQueue.begin(), healedPatientsQueue.end(), record.healedPatientsQueue);
+    record.lists[0] = writer.addList(clinics.copy());
+
+    // No thread runs during a save, the notifications are drained and queued again in the same order
+    std::vector<Seller*> announced;
+    Seller* clinic = nullptr;
+    while (healedPatientsReady.pop(clinic)) {
+        announced.push_back(clinic);
+    }
+    for (Seller* seller : announced) {
+        healedPatientsReady.push(seller);
+    }
+    record.lists[1] = writer.addList(announced);
+}
+
+void Hospital::restoreState(const CheckpointRecord& record, const CheckpointReader& checkpoint) {
+    Seller::restoreState(record, checkpoint);
+    maxBeds = record.counters[0];
+    currentBeds = record.counters[1];
+    nbHospitalised.store(record.counters[2], std::memory_order_relaxed);
+    nbFree = record.counters[3];
+    std::copy(record.healedPatientsQueue, record.healedPatientsQueue + NB_DAYS_OF_REST, healedPatientsQueue.begin());
+    clinics = checkpoint.getSellers(record.lists[0]);
+
+    Seller* clinic = nullptr;
+    while (healedPatientsReady.pop(clinic)) {}
+    for (Seller* announced : checkpoint.getSellers(record.lists[1])) {
+        healedPatientsReady.push(announced);
+    }
+    updateInterface();
 }
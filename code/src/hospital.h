@@ -3,9 +3,13 @@
 
 #include <vector>
 #include <array>
+#include <deque>
+#include <pcosynchro/pcoconditionvariable.h>
 
 #include "iwindowinterface.h"
 #include "sellerMutex.h"
+#include "sellerList.h"
+#include "mpscQueue.h"
 
 #define NB_DAYS_OF_REST 5
 #define BENEFIT_OF_HEALING 60
@@ -41,6 +45,7 @@ public:
 
     /**
      * @brief Fonction permettant de proposer des ressources au vendeur
+     * Les patients sont acceptés partiellement si l'hôpital n'a pas assez de lits ou d'argent pour tous.
      * @param what Le type de resource
      * @param qty Nombre de ressources
      * @param bill Le coût de la transaction
@@ -48,6 +53,30 @@ public:
      */
     int send(ItemType it, int qty, int bill) override;
 
+    /**
+     * @brief Fonction permettant de proposer des patients malades en attendant qu'un lit se libère
+     * Les ambulances en attente forment une file et sont admises dans leur ordre d'arrivée,
+     * dès qu'un lit est libéré par request ou freeHealedPatient.
+     * @param what Le type de resource
+     * @param qty Nombre de ressources
+     * @param bill Le coût de la transaction
+     * @param timeoutSeconds Temps d'attente maximal en secondes
+     * @return La quantité acceptée, 0 si le délai est écoulé ou si l'hôpital s'arrête
+     */
+    int sendBlocking(ItemType it, int qty, int bill, int timeoutSeconds) override;
+
+    /**
+     * @brief getAdmissionCapacity
+     * @return Le nombre de patients malades que l'hôpital peut admettre immédiatement
+     */
+    int getAdmissionCapacity(ItemType what) override;
+
+    /**
+     * @brief setFinished
+     * Arrête l'hôpital et réveille les ambulances en attente d'admission
+     */
+    void setFinished() override;
+
     /**
      * @brief Fonction permettant d'acheter des ressources au vendeur
      * @param what Le type de resource à acheter
@@ -63,8 +92,46 @@ public:
      */
     void setClinics(std::vector<Seller*> clinics);
 
+    /**
+     * @brief addClinic
+     * @param clinic Clinique qui renverra aussi ses patients soignés à l'hôpital, peut être appelée pendant la simulation
+     */
+    void addClinic(Seller* clinic);
+
+    /**
+     * @brief getTradingPartners
+     * @return Les cliniques auxquelles l'hôpital rachète les patients soignés
+     */
+    std::vector<Seller*> getTradingPartners() override;
+
+    /**
+     * @brief notifyHealedPatientReady
+     * @param clinic La clinique qui a un patient soigné à transférer
+     * Appelée par une clinique abonnée, depuis son propre thread, à chaque patient soigné.
+     * L'hôpital réclame ensuite ce patient dans transferPatientsFromClinic, sans sonder les autres cliniques.
+     */
+    void notifyHealedPatientReady(Seller* clinic);
+
+    /**
+     * @brief getNumberPatients
+     * @return Les patients malades et soignés de l'instantané publié, plus les patients sortis lus sous le mutex
+     */
     int getNumberPatients();
 
+    /**
+     * @brief getNumberDischarged
+     * @return Le nombre de patients sortis soignés de l'hôpital, lu sous le mutex
+     */
+    int getNumberDischarged();
+
+    /**
+     * @brief getOccupiedBeds
+     * @return Le nombre de lits actuellement occupés, lu sous le mutex
+     */
+    int getOccupiedBeds();
+
+    int getMaxBeds() { return maxBeds; }
+
     /**
      * @brief getAmountPaidToWorkers
      * @return Le montant total payé aux travailleurs de l'ambulance.
@@ -77,10 +144,34 @@ public:
     */
     int getFundingFromHealed();
 
+    /**
+     * @brief saveState
+     * Sauvegarde aussi les lits, les jours de repos des patients soignés, les compteurs, les cliniques liées
+     * et les patients soignés annoncés mais pas encore transférés
+     */
+    void saveState(CheckpointRecord& record, CheckpointWriter& writer) override;
+
+    void restoreState(const CheckpointRecord& record, const CheckpointReader& checkpoint) override;
+
+protected:
+    /**
+     * @brief canSell
+     * @return true si l'hôpital a assez de patients malades à céder, le mutex doit être verrouillé
+     */
+    bool canSell(ItemType what, int qty) override;
+
+    /**
+     * @brief sell
+     * Cède les patients malades et libère leurs lits, le mutex doit être verrouillé
+     * @return La facture de la vente
+     */
+    int sell(ItemType what, int qty) override;
+
 private:
     /**
      * @brief transferPatientsFromClinic
      * Transfère des patients d'une clinique vers l'hôpital.
+     * Seules les cliniques ayant notifié un patient soigné sont sollicitées, tant qu'il reste des lits.
      * Cette fonction est appelée dans le cadre de l'intégration avec les cliniques et gère l'arrivée de patients soignés.
      */
     void transferPatientsFromClinic();
@@ -106,16 +197,36 @@ private:
 
     void freeHealedPatient();
 
-    std::vector<Seller*> clinics;     // Liste des cliniques liées à l'hôpital, qui renvoient des patients soignés
+    /**
+     * @brief getAdmissibleQuantity
+     * @param qty Nombre de patients proposés
+     * @param costPerPatient Coût du transfert d'un patient, infirmier/infirmière compris
+     * @return Le nombre de patients malades que l'hôpital peut admettre, limité par ses lits libres et son argent, le mutex doit être verrouillé
+     */
+    int getAdmissibleQuantity(int qty, int costPerPatient);
+
+    /**
+     * @brief admit
+     * Admet qty patients malades et paie leur transfert, le mutex doit être verrouillé
+     */
+    void admit(int qty, int costPerPatient);
+
+    SellerList clinics;               // Liste des cliniques liées à l'hôpital, qui renvoient des patients soignés
 
     int maxBeds;        // Nombre maximum de lits disponibles à l'hôpital
     int currentBeds;    // Nombre actuel de lits occupés, représente le nombre de patients présents
 
-    int nbHospitalised; //Nombre de transfert réussi vers l'hôpital (nombre de fois ou un(e) infirmier/infirmière est payé)
+    std::atomic<int> nbHospitalised; //Nombre de transfert réussi vers l'hôpital (nombre de fois ou un(e) infirmier/infirmière est payé)
 
     int nbFree; // Nombre de personnes qui sont sorties soignées de l'hôpital.
 
     std::array<int, NB_DAYS_OF_REST> healedPatientsQueue; // Liste du nombre de jours à attendre à l'hôpital pour les patients soignés
+
+    std::deque<unsigned long> admissionQueue; // Tickets des ambulances en attente d'un lit, dans l'ordre d'arrivée
+    unsigned long nextAdmissionTicket;        // Ticket attribué à la prochaine ambulance en attente
+    PcoConditionVariable admissionCondition;  // Signalée lorsqu'un lit ou de l'argent se libère
+
+    MpscQueue<Seller*> healedPatientsReady; // Une entrée par patient soigné annoncé par une clinique, consommée par le thread de l'hôpital
 };
 
 #endif // HOSPITAL_H
@@ -0,0 +1,125 @@
+#include "instrumentedMutex.h"
+#include <algorithm>
+#include <vector>
+
+static PcoMutex registryMutex;
+static std::vector<InstrumentedMutex*>& registry() {
+    static std::vector<InstrumentedMutex*> mutexes;
+    return mutexes;
+}
+
+QString getLockRoleName(LockRole role) {
+    switch (role) {
+        case LockRole::Resources : return "resources";
+        case LockRole::Interface : return "interface";
+        default : return "???";
+    }
+}
+
+InstrumentedMutex::InstrumentedMutex(int ownerId, LockRole role)
+    : mutex(), ownerId(ownerId), role(role),
+      acquisitions(0), contendedAcquisitions(0), waitNanoseconds(0), holdNanoseconds(0), acquiredAt(0)
+{
+    registryMutex.lock();
+    registry().push_back(this);
+    registryMutex.unlock();
+}
+
+InstrumentedMutex::~InstrumentedMutex() {
+    registryMutex.lock();
+    registry().erase(std::remove(registry().begin(), registry().end(), this), registry().end());
+    registryMutex.unlock();
+}
+
+uint64_t InstrumentedMutex::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void InstrumentedMutex::acquired(uint64_t waited, bool contended) {
+    // Only the holder writes the counters, plain load/store pairs are enough
+    acquisitions.store(acquisitions.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (contended) {
+        contendedAcquisitions.store(contendedAcquisitions.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        waitNanoseconds.store(waitNanoseconds.load(std::memory_order_relaxed) + waited, std::memory_order_relaxed);
+    }
+    acquiredAt = now();
+}
+
+uint64_t InstrumentedMutex::lock() {
+    if (mutex.trylock()) {
+        acquired(0, false);
+        return 0;
+    }
+
+    uint64_t start = now();
+    mutex.lock();
+    uint64_t waited = now() - start;
+    acquired(waited, true);
+    return waited;
+}
+
+bool InstrumentedMutex::trylock() {
+    if (!mutex.trylock()) {
+        return false;
+    }
+    acquired(0, false);
+    return true;
+}
+
+void InstrumentedMutex::unlock() {
+    holdNanoseconds.store(holdNanoseconds.load(std::memory_order_relaxed) + (now() - acquiredAt), std::memory_order_relaxed);
+    mutex.unlock();
+}
+
+bool InstrumentedMutex::wait(PcoConditionVariable& condition, int timeoutSeconds) {
+    holdNanoseconds.store(holdNanoseconds.load(std::memory_order_relaxed) + (now() - acquiredAt), std::memory_order_relaxed);
+    bool signaled = condition.waitForSeconds(&mutex, timeoutSeconds);
+    acquiredAt = now();
+    return signaled;
+}
+
+QString InstrumentedMutex::report(size_t maxLocks) {
+    struct LockCounters {
+        int ownerId;
+        LockRole role;
+        uint64_t acquisitions;
+        uint64_t contended;
+        uint64_t waited;
+        uint64_t held;
+    };
+
+    // The registry stays locked while the counters are read, a mutex can't be destroyed under us
+    std::vector<LockCounters> locks;
+    registryMutex.lock();
+    locks.reserve(registry().size());
+    for (InstrumentedMutex* mutex : registry()) {
+        locks.push_back({mutex->ownerId, mutex->role,
+                         mutex->acquisitions.load(std::memory_order_relaxed),
+                         mutex->contendedAcquisitions.load(std::memory_order_relaxed),
+                         mutex->waitNanoseconds.load(std::memory_order_relaxed),
+                         mutex->holdNanoseconds.load(std::memory_order_relaxed)});
+    }
+    registryMutex.unlock();
+
+    std::sort(locks.begin(), locks.end(), [](const LockCounters& a, const LockCounters& b) {
+        return a.waited > b.waited;
+    });
+
+    QString report = QString("Most contended locks (%1 locks) :").arg(static_cast<unsigned long long>(locks.size()));
+
+    for (size_t i = 0; i < std::min(maxLocks, locks.size()); ++i) {
+        const LockCounters& lock = locks[i];
+
+        report += QString("\n  seller %1 %2 : acquisitions=%3 contended=%4 (%5%) wait=%6us (avg %7ns) hold=%8us (avg %9ns)")
+                      .arg(lock.ownerId).arg(getLockRoleName(lock.role))
+                      .arg(static_cast<unsigned long long>(lock.acquisitions))
+                      .arg(static_cast<unsigned long long>(lock.contended))
+                      .arg(lock.acquisitions ? 100.0 * lock.contended / lock.acquisitions : 0.0, 0, 'f', 1)
+                      .arg(static_cast<unsigned long long>(lock.waited / 1000))
+                      .arg(static_cast<unsigned long long>(lock.contended ? lock.waited / lock.contended : 0))
+                      .arg(static_cast<unsigned long long>(lock.held / 1000))
+                      .arg(static_cast<unsigned long long>(lock.acquisitions ? lock.held / lock.acquisitions : 0));
+    }
+
+    return report;
+}
@@ -0,0 +1,79 @@
+#ifndef INSTRUMENTEDMUTEX_H
+#define INSTRUMENTEDMUTEX_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <QString>
+#include <pcosynchro/pcomutex.h>
+#include <pcosynchro/pcoconditionvariable.h>
+
+/**
+ * @brief Rôle d'un mutex dans son vendeur
+ */
+enum class LockRole { Resources, Interface };
+
+QString getLockRoleName(LockRole role);
+
+/**
+ * @brief The InstrumentedMutex class
+ * Remplace un PcoMutex en comptant, pour chaque instance, les acquisitions, les acquisitions contendues,
+ * le temps d'attente et le temps de détention. Les compteurs ne sont modifiés que par le thread détenant le verrou.
+ * Toutes les instances vivantes sont enregistrées pour pouvoir classer les verrous les plus contendus.
+ */
+class InstrumentedMutex {
+public:
+    /**
+     * @brief InstrumentedMutex
+     * @param ownerId Identifiant du vendeur possédant le mutex
+     * @param role Rôle du mutex dans le vendeur
+     */
+    InstrumentedMutex(int ownerId, LockRole role);
+    ~InstrumentedMutex();
+
+    InstrumentedMutex(const InstrumentedMutex&) = delete;
+    InstrumentedMutex& operator=(const InstrumentedMutex&) = delete;
+
+    /**
+     * @brief lock
+     * @return Le temps passé à attendre le mutex en nanosecondes, 0 s'il était libre
+     */
+    uint64_t lock();
+
+    bool trylock();
+
+    void unlock();
+
+    /**
+     * @brief wait
+     * @param condition La condition à attendre, le mutex doit être détenu et l'est à nouveau au retour
+     * @param timeoutSeconds Temps d'attente maximal en secondes
+     * @return false si l'attente a expiré
+     * Le temps passé dans la condition ne compte pas comme temps de détention.
+     */
+    bool wait(PcoConditionVariable& condition, int timeoutSeconds);
+
+    /**
+     * @brief report
+     * @param maxLocks Nombre de verrous affichés
+     * @return Les verrous vivants classés par temps d'attente total décroissant
+     */
+    static QString report(size_t maxLocks);
+
+private:
+    void acquired(uint64_t waitNanoseconds, bool contended);
+
+    static uint64_t now();
+
+    PcoMutex mutex;
+    int ownerId;
+    LockRole role;
+
+    std::atomic<uint64_t> acquisitions;
+    std::atomic<uint64_t> contendedAcquisitions;
+    std::atomic<uint64_t> waitNanoseconds;
+    std::atomic<uint64_t> holdNanoseconds;
+    uint64_t acquiredAt; // Instant de la dernière acquisition, accédé uniquement par le détenteur
+};
+
+#endif // INSTRUMENTEDMUTEX_H
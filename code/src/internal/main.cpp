@@ -1,7 +1,18 @@
 #include <QApplication>
+#include <cstdlib>
+#include <memory>
 
 #include "utils.h"
 #include "iwindowinterface.h"
+#include "trace.h"
+#include "metricsExporter.h"
+#include "replay.h"
+#include "transactionLog.h"
+#include "stateSampler.h"
+#include "checkpoint.h"
+#include "placement.h"
+#include "patientArrival.h"
+#include <random>
 #ifdef TESTING_MODE
 #include "fakeinterface.h"
 #else
@@ -12,19 +23,83 @@ int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
 
+    // PCO_TRACE_FILE=trace.json enregistre une trace lisible par Perfetto (ui.perfetto.dev)
+    if (const char* tracePath = std::getenv("PCO_TRACE_FILE")) {
+        Trace::enable(tracePath);
+    }
+
+    // PCO_RECORD=run.rec [PCO_SEED=42] enregistre l'ordre des opérations, PCO_REPLAY=run.rec le rejoue
+    if (const char* recordPath = std::getenv("PCO_RECORD")) {
+        const char* seed = std::getenv("PCO_SEED");
+        Replay::startRecording(recordPath, seed ? std::strtoull(seed, nullptr, 10) : std::random_device{}());
+    } else if (const char* replayPath = std::getenv("PCO_REPLAY")) {
+        if (!Replay::startReplay(replayPath)) {
+            return -1;
+        }
+    }
+
+    // PCO_TXLOG=run.txlog journalise chaque échange, production, traitement, admission et sortie, lisible avec pco_txlog
+    if (const char* txlogPath = std::getenv("PCO_TXLOG")) {
+        if (!TransactionLog::open(txlogPath)) {
+            return -1;
+        }
+    }
+
+    // PCO_METRICS_FILE=metrics.prom et/ou PCO_METRICS_SOCKET=/tmp/pco.sock exposent les métriques au format Prometheus
+    const char* metricsFile = std::getenv("PCO_METRICS_FILE");
+    const char* metricsSocket = std::getenv("PCO_METRICS_SOCKET");
+    MetricsExporter::configure(metricsFile ? metricsFile : "", metricsSocket ? metricsSocket : "");
+
+    // PCO_SAMPLES=run.samples [PCO_SAMPLE_PERIOD_MS=100] échantillonne l'argent et les stocks, lisible avec pco_samples
+    const char* samplesPath = std::getenv("PCO_SAMPLES");
+    const char* samplePeriod = std::getenv("PCO_SAMPLE_PERIOD_MS");
+    StateSampler::configure(samplesPath ? samplesPath : "", samplePeriod ? std::atoi(samplePeriod) : SAMPLER_PERIOD_MS);
+
+    // PCO_CHECKPOINT_LOAD=state.ckpt reprend la simulation d'un point de reprise, PCO_CHECKPOINT_SAVE=state.ckpt le sauvegarde à la fin
+    const char* checkpointLoad = std::getenv("PCO_CHECKPOINT_LOAD");
+    const char* checkpointSave = std::getenv("PCO_CHECKPOINT_SAVE");
+    Checkpoint::configure(checkpointLoad ? checkpointLoad : "", checkpointSave ? checkpointSave : "");
+
+    // PCO_SCENARIO=deploiement.scenario remplace la configuration de utils.h par le déploiement décrit (voir topology.h)
+    const char* scenarioPath = std::getenv("PCO_SCENARIO");
+    TopologySpec spec;
+    if (scenarioPath && !spec.load(scenarioPath)) {
+        return -1;
+    }
+
+    // PCO_ARRIVAL_RATE=50 [PCO_ARRIVAL_PROCESS=poisson|bursty] génère des patients en continu au taux donné par seconde,
+    // PCO_ARRIVAL_PROCESS=trace PCO_ARRIVAL_TRACE=arrivees.txt rejoue des instants d'arrivée (voir patientArrival.h)
+    const char* arrivalRate = std::getenv("PCO_ARRIVAL_RATE");
+    const char* arrivalProcess = std::getenv("PCO_ARRIVAL_PROCESS");
+    const char* arrivalTrace = std::getenv("PCO_ARRIVAL_TRACE");
+    ArrivalProcess process = !arrivalProcess ? ArrivalProcess::Poisson : std::string(arrivalProcess) == "bursty" ? ArrivalProcess::Bursty :
+                             std::string(arrivalProcess) == "trace" ? ArrivalProcess::Trace : ArrivalProcess::Poisson;
+    if (!PatientArrivalGenerator::configure(process, arrivalRate ? std::atof(arrivalRate) : 0, arrivalTrace ? arrivalTrace : "")) {
+        return -1;
+    }
+
+    // PCO_AFFINITY=core attache chaque entité à un cœur, PCO_AFFINITY=node aux cœurs de son nœud NUMA
+    const char* affinity = std::getenv("PCO_AFFINITY");
+    Placement::configure(!affinity ? AffinityMode::None : std::string(affinity) == "core" ? AffinityMode::Core :
+                         std::string(affinity) == "node" ? AffinityMode::Node : AffinityMode::None);
+
     IWindowInterface* windowInterface;
 
     #ifdef TESTING_MODE
         windowInterface = new FakeInterface();
     #else
-        WindowInterface::initialize(NB_SUPPLIER, NB_CLINICS, NB_HOSPITALS);
+        if (scenarioPath) {
+            WindowInterface::initialize(spec.getNbSuppliers(), spec.getNbClinics(), spec.nbHospitals);
+        } else {
+            WindowInterface::initialize(NB_SUPPLIER, NB_CLINICS, NB_HOSPITALS);
+        }
         windowInterface = new WindowInterface();
     #endif
 
     SellerInterface::setInterface(windowInterface);
 
-    Utils utils = Utils(NB_SUPPLIER, NB_CLINICS, NB_HOSPITALS);
-    windowInterface->setUtils(&utils);
+    std::unique_ptr<Utils> utils = scenarioPath ? std::make_unique<Utils>(spec) : std::make_unique<Utils>(NB_SUPPLIER, NB_CLINICS, NB_HOSPITALS);
+    windowInterface->setUtils(utils.get());
 
     return a.exec();
 }
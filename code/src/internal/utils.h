@@ -5,6 +5,7 @@
 #include <QRandomGenerator>
 #include <pcosynchro/pcothread.h>
 #include <pcosynchro/pcosemaphore.h>
+#include <pcosynchro/pcomutex.h>
 #include <QDebug>
 #include <QTextStream>
 
@@ -12,6 +13,15 @@
 #include "clinic.h"
 #include "hospital.h"
 #include "ambulance.h"
+#include "patientArrival.h"
+#include "metricsExporter.h"
+#include "conservationAuditor.h"
+#include "stateSampler.h"
+#include "checkpoint.h"
+#include "topology.h"
+#include "placement.h"
+#include "world.h"
+#include "worldView.h"
 
 #define NB_SUPPLIER 3
 #define NB_CLINICS 3
@@ -31,35 +41,168 @@
 
 #define MAX_BEDS_PER_HOSTPITAL 35
 
-std::vector<Ambulance*> createAmbulances(int nbAmbulances, int idStart);
-std::vector<Supplier*> createSuppliers(int nbSuppliers, int idStart);
-std::vector<Clinic*> createClinics(int nbClinics, int idStart);
-std::vector<Hospital*> createHospitals(int nbHospitals, int idStart);
+#define LATENCY_REPORT_MAX_SELLERS 16                   // Au-delà, seuls les histogrammes fusionnés de tous les vendeurs sont affichés
+
+#define LOCK_REPORT_MAX_LOCKS 10                        // Nombre de verrous les plus contendus affichés en fin de service
+
+#define CONSERVATION_AUDIT_PERIOD_MS 100                // Intervalle de vérification de l'argent et des patients, 0 pour désactiver l'auditeur
+
+std::vector<Ambulance*> createAmbulances(World& world, int nbAmbulances, int idStart);
+std::vector<Supplier*> createSuppliers(World& world, int nbSuppliers, int idStart);
+std::vector<Clinic*> createClinics(World& world, int nbClinics, int idStart);
+std::vector<Hospital*> createHospitals(World& world, int nbHospitals, int idStart);
 
 class Utils {
 public:
     void externalEndService();
     QString getFinalReport();
 
+    /**
+     * @brief getSellers
+     * @return Toutes les entités de la simulation
+     */
+    std::vector<Seller*> getSellers();
+
+    /**
+     * @brief getInitialPatients
+     * @return Le nombre de patients malades confiés aux ambulances au départ
+     */
+    int getInitialPatients();
+
+    /**
+     * @brief getNumberDischarged
+     * @return Le nombre de patients sortis soignés des hôpitaux, peut être lu pendant la simulation
+     */
+    int getNumberDischarged();
+
+    /**
+     * @brief addHospital
+     * @param region Région de l'hôpital, il est relié aux cliniques et aux ambulances de cette région
+     * @return L'hôpital créé et lancé, nullptr si le service est terminé
+     * Les entités ajoutées ou retirées pendant la simulation le sont sans arrêter les autres threads, qui voient
+     * leurs nouvelles listes de partenaires au prochain échange (voir SellerList). Elles sont comptées dans le bilan final,
+     * mais pas dans les services créés au lancement (métriques, échantillonnage, arrivées), dans le journal de rejeu ni
+     * dans l'interface graphique, qui n'affiche que les entités créées au départ.
+     */
+    Hospital* addHospital(int region = 0);
+
+    /**
+     * @brief addClinic
+     * @param region Région de la clinique, elle est reliée aux hôpitaux et aux fournisseurs de cette région
+     * @return La clinique créée et lancée, de la spécialité suivante dans l'ordre de createClinics, nullptr si le service est terminé
+     */
+    Clinic* addClinic(int region = 0);
+
+    /**
+     * @brief addSupplier
+     * @param region Région du fournisseur, il est relié aux cliniques de cette région
+     * @return Le fournisseur créé et lancé, alternativement de dispositifs médicaux et pharmacie, nullptr si le service est terminé
+     */
+    Supplier* addSupplier(int region = 0);
+
+    /**
+     * @brief drain
+     * @param seller Hôpital, clinique ou fournisseur qui ne reçoit plus de nouveau travail
+     * Les ambulances n'envoient plus de patients à un hôpital retiré, qui se vide par les cliniques ; une clinique retirée
+     * n'achète plus de patients malades et cède ceux qu'elle a soignés ; les cliniques n'achètent plus rien à un fournisseur retiré.
+     * L'entité continue jusqu'à la fin du service, rien n'est perdu pour le bilan.
+     */
+    void drain(Seller* seller);
+
 private:
+    std::unique_ptr<World> world;  // Détruit en dernier, après les threads et les services qui utilisent les entités
+
     std::vector<Ambulance*> ambulances;
     std::vector<Supplier*> suppliers;
     std::vector<Clinic*> clinics;
     std::vector<Hospital*> hospitals;
 
+    std::unique_ptr<PatientArrivalGenerator> arrivalGenerator; // Source continue de patients, absente en boucle fermée
+
+    std::unique_ptr<MetricsExporter> metricsExporter; // Export continu des métriques, absent s'il n'est pas configuré
+
+    std::unique_ptr<ConservationAuditor> auditor;     // Vérification continue de la conservation, absente si désactivée
+
+    std::unique_ptr<StateSampler> stateSampler;       // Échantillonnage de l'état des vendeurs, absent s'il n'est pas configuré
+
     std::vector<std::unique_ptr<PcoThread>> threads;
+    std::vector<std::unique_ptr<PcoThread>> addedThreads;  // Threads des entités ajoutées pendant la simulation
     std::unique_ptr<PcoThread> utilsThread;
 
+    PcoMutex topologyMutex;        // Protège les listes d'entités et leurs threads contre les ajouts pendant la simulation
+    bool running = false;          // Les threads des entités sont lancés, une entité ajoutée lance le sien
+    bool finishing = false;        // La fin du service est demandée, plus aucune entité n'est ajoutée
+    int nextId = 0;                // Identifiant de la prochaine entité ajoutée
+
     QString finalReport;
 
+    uint64_t restoredArrivals = 0; // Patients arrivés avant le point de reprise chargé
+
+    int initialFund = 0;           // Argent de toutes les entités à leur création
+    int initialPatients = 0;       // Patients malades confiés aux ambulances à leur création
+
+    bool ended = false;            // externalEndService a déjà attendu la fin de la simulation
+
     void endService();
 
+    /**
+     * @brief getCheckpointKinds
+     * @return Le type de chaque entité, dans l'ordre de getSellers
+     */
+    std::vector<CheckpointKind> getCheckpointKinds();
+
+    /**
+     * @brief loadCheckpoint
+     * @param path Point de reprise sauvegardé par saveCheckpoint avec la même configuration
+     * Restaure l'état de toutes les entités avant le lancement des threads, quitte si le point de reprise ne correspond pas
+     */
+    void loadCheckpoint(const QString& path);
+
+    /**
+     * @brief saveCheckpoint
+     * @param path Fichier du point de reprise
+     * @param nbArrivals Patients arrivés depuis le début de la simulation
+     * @return false si le fichier ne peut pas être écrit, les threads des entités doivent être terminés
+     */
+    bool saveCheckpoint(const QString& path, uint64_t nbArrivals);
+
+    /**
+     * @brief latencyReport
+     * @return Les histogrammes de latence de chaque vendeur et leur fusion par opération
+     */
+    QString latencyReport();
+
+    /**
+     * @brief start
+     * Reprend le point de reprise éventuel, crée les services configurés et lance la simulation, les entités doivent être reliées
+     */
+    void start();
+
     void run();
 
+    /**
+     * @brief launch
+     * Compte l'argent de l'entité ajoutée et lance son thread si la simulation a commencé, topologyMutex doit être verrouillé
+     */
+    template<typename T>
+    void launch(T* seller);
+
     PcoSemaphore semEnd{0};
 public:
     Utils(int nbSupplier, int nbClinic, int nbHospital);
 
+    /**
+     * @brief Utils
+     * @param spec Déploiement décrit par un fichier de scénario, créé et relié par generateTopology
+     */
+    Utils(const TopologySpec& spec);
+
+    /**
+     * @brief ~Utils
+     * Termine la simulation si externalEndService n'a pas été appelée, puis libère toutes les entités d'un coup
+     */
+    ~Utils();
+
 
 };
 
@@ -0,0 +1,129 @@
+#include "latencyHistogram.h"
+#include <algorithm>
+
+QString getOperationName(SellerOperation operation) {
+    switch (operation) {
+        case SellerOperation::Request : return "request";
+        case SellerOperation::Send : return "send";
+        case SellerOperation::Admission : return "sendBlocking";
+        case SellerOperation::Buy : return "buyFromSeller";
+        case SellerOperation::Bundle : return "buyBundleFromSellers";
+        case SellerOperation::LockWait : return "lock wait";
+        default : return "???";
+    }
+}
+
+LatencyHistogram::LatencyHistogram() : count(0), sum(0), max(0) {
+    for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+int LatencyHistogram::getBucket(uint64_t nanoseconds) {
+    if (nanoseconds < NB_SUB_BUCKETS) {
+        return static_cast<int>(nanoseconds);
+    }
+    int magnitude = 63 - __builtin_clzll(nanoseconds);
+    int shift = magnitude - LATENCY_SUB_BUCKET_BITS;
+    int bucket = (shift + 1) * NB_SUB_BUCKETS + static_cast<int>((nanoseconds >> shift) & (NB_SUB_BUCKETS - 1));
+    return std::min(bucket, NB_BUCKETS - 1);
+}
+
+uint64_t LatencyHistogram::getBucketUpperBound(int bucket) {
+    if (bucket < NB_SUB_BUCKETS) {
+        return bucket;
+    }
+    int shift = bucket / NB_SUB_BUCKETS - 1;
+    uint64_t lower = static_cast<uint64_t>(NB_SUB_BUCKETS + bucket % NB_SUB_BUCKETS) << shift;
+    return lower + (uint64_t(1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds) {
+    buckets[getBucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+    uint64_t previous = max.load(std::memory_order_relaxed);
+    while (nanoseconds > previous && !max.compare_exchange_weak(previous, nanoseconds, std::memory_order_relaxed)) {}
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (int i = 0; i < NB_BUCKETS; ++i) {
+        buckets[i].fetch_add(other.buckets[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    count.fetch_add(other.count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    sum.fetch_add(other.sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    uint64_t otherMax = other.max.load(std::memory_order_relaxed);
+    uint64_t previous = max.load(std::memory_order_relaxed);
+    while (otherMax > previous && !max.compare_exchange_weak(previous, otherMax, std::memory_order_relaxed)) {}
+}
+
+uint64_t LatencyHistogram::getCount() const {
+    return count.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::getMax() const {
+    return max.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::getMean() const {
+    uint64_t n = getCount();
+    return n ? static_cast<double>(sum.load(std::memory_order_relaxed)) / n : 0;
+}
+
+uint64_t LatencyHistogram::getPercentile(double percentile) const {
+    uint64_t n = getCount();
+    if (n == 0) {
+        return 0;
+    }
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(percentile * n + 0.5));
+    uint64_t seen = 0;
+    for (int i = 0; i < NB_BUCKETS; ++i) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return std::min(getBucketUpperBound(i), getMax());
+        }
+    }
+    return getMax();
+}
+
+QString LatencyHistogram::summary() const {
+    return QString("n=%1 mean=%2ns p50=%3ns p90=%4ns p99=%5ns max=%6ns")
+        .arg(static_cast<unsigned long long>(getCount()))
+        .arg(getMean(), 0, 'f', 0)
+        .arg(static_cast<unsigned long long>(getPercentile(0.5)))
+        .arg(static_cast<unsigned long long>(getPercentile(0.9)))
+        .arg(static_cast<unsigned long long>(getPercentile(0.99)))
+        .arg(static_cast<unsigned long long>(getMax()));
+}
+
+LatencyRecorder::LatencyRecorder() {
+    for (auto& histogram : histograms) {
+        histogram.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+LatencyRecorder::~LatencyRecorder() {
+    for (auto& histogram : histograms) {
+        delete histogram.load(std::memory_order_relaxed);
+    }
+}
+
+void LatencyRecorder::record(SellerOperation operation, uint64_t nanoseconds) {
+    std::atomic<LatencyHistogram*>& slot = histograms[static_cast<int>(operation)];
+    LatencyHistogram* histogram = slot.load(std::memory_order_acquire);
+    if (!histogram) {
+        LatencyHistogram* created = new LatencyHistogram();
+        if (slot.compare_exchange_strong(histogram, created, std::memory_order_acq_rel)) {
+            histogram = created;
+        } else {
+            delete created;
+        }
+    }
+    histogram->record(nanoseconds);
+}
+
+const LatencyHistogram* LatencyRecorder::get(SellerOperation operation) const {
+    return histograms[static_cast<int>(operation)].load(std::memory_order_acquire);
+}
@@ -0,0 +1,116 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <QString>
+
+#define LATENCY_SUB_BUCKET_BITS 3   // 8 sous-intervalles par puissance de 2, soit 12.5% de précision relative
+#define LATENCY_MAX_MAGNITUDE 40    // Durées jusqu'à 2^40 ns (environ 18 minutes)
+
+/**
+ * @brief Opérations d'un vendeur dont la latence est mesurée
+ */
+enum class SellerOperation { Request, Send, Admission, Buy, Bundle, LockWait, NbOperations };
+
+QString getOperationName(SellerOperation operation);
+
+/**
+ * @brief The LatencyHistogram class
+ * Histogramme log-linéaire (style HDR) de durées en nanosecondes.
+ * record() est sans attente : un fetch_add relâché par compteur, appelable depuis n'importe quel thread.
+ */
+class LatencyHistogram {
+public:
+    static constexpr int NB_SUB_BUCKETS = 1 << LATENCY_SUB_BUCKET_BITS;
+    static constexpr int NB_BUCKETS = (LATENCY_MAX_MAGNITUDE - LATENCY_SUB_BUCKET_BITS + 2) * NB_SUB_BUCKETS;
+
+    LatencyHistogram();
+
+    /**
+     * @brief record
+     * @param nanoseconds La durée mesurée
+     */
+    void record(uint64_t nanoseconds);
+
+    /**
+     * @brief merge
+     * @param other Histogramme dont les comptes sont ajoutés à celui-ci
+     */
+    void merge(const LatencyHistogram& other);
+
+    uint64_t getCount() const;
+
+    uint64_t getMax() const;
+
+    double getMean() const;
+
+    /**
+     * @brief getPercentile
+     * @param percentile Entre 0 et 1
+     * @return La borne supérieure de l'intervalle contenant le percentile, en nanosecondes
+     */
+    uint64_t getPercentile(double percentile) const;
+
+    /**
+     * @brief summary
+     * @return Une ligne résumant la distribution
+     */
+    QString summary() const;
+
+private:
+    static int getBucket(uint64_t nanoseconds);
+    static uint64_t getBucketUpperBound(int bucket);
+
+    std::atomic<uint32_t> buckets[NB_BUCKETS];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+};
+
+/**
+ * @brief The LatencyRecorder class
+ * Un histogramme par opération d'un vendeur, alloué à la première mesure.
+ */
+class LatencyRecorder {
+public:
+    LatencyRecorder();
+    ~LatencyRecorder();
+
+    LatencyRecorder(const LatencyRecorder&) = delete;
+    LatencyRecorder& operator=(const LatencyRecorder&) = delete;
+
+    void record(SellerOperation operation, uint64_t nanoseconds);
+
+    /**
+     * @brief get
+     * @return L'histogramme de l'opération, nullptr si elle n'a jamais été mesurée
+     */
+    const LatencyHistogram* get(SellerOperation operation) const;
+
+private:
+    std::atomic<LatencyHistogram*> histograms[static_cast<int>(SellerOperation::NbOperations)];
+};
+
+/**
+ * @brief The ScopedLatency class
+ * Mesure la durée de la portée courante et l'enregistre à sa sortie.
+ */
+class ScopedLatency {
+public:
+    ScopedLatency(LatencyRecorder& recorder, SellerOperation operation)
+        : recorder(recorder), operation(operation), start(std::chrono::steady_clock::now()) {}
+
+    ~ScopedLatency() {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        recorder.record(operation, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+
+private:
+    LatencyRecorder& recorder;
+    SellerOperation operation;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif // LATENCYHISTOGRAM_H
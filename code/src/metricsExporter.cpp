@@ -0,0 +1,242 @@
+#include "metricsExporter.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+std::string MetricsExporter::filePath;
+std::string MetricsExporter::socketPath;
+
+namespace {
+
+struct SellerSample {
+    const char* kind;
+    int id;
+    SellerSnapshot state;
+    uint64_t accepted;
+    uint64_t refused;
+    uint64_t crossRegion;
+    int paidToWorkers;
+    int patients;
+};
+
+template<typename T>
+void sample(std::vector<SellerSample>& samples, const char* kind, const std::vector<T*>& sellers) {
+    for (T* seller : sellers) {
+        samples.push_back({kind, seller->getUniqueId(), seller->getSnapshot(),
+                           seller->getTradesAccepted(), seller->getTradesRefused(), seller->getTradesCrossRegion(),
+                           seller->getAmountPaidToWorkers(), WorldView::patientsOf(seller)});
+    }
+}
+
+void family(std::ostringstream& out, const char* name, const char* type, const char* help) {
+    out << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+}
+
+std::string labels(const char* kind, int id) {
+    return "seller=\"" + std::to_string(id) + "\",kind=\"" + kind + "\"";
+}
+
+}
+
+void MetricsExporter::configure(const QString& file, const QString& socket) {
+    filePath = file.toStdString();
+    socketPath = socket.toStdString();
+}
+
+bool MetricsExporter::isEnabled() {
+    return !filePath.empty() || !socketPath.empty();
+}
+
+MetricsExporter::MetricsExporter(std::vector<Ambulance*> ambulances, std::vector<Supplier*> suppliers,
+                                 std::vector<Clinic*> clinics, std::vector<Hospital*> hospitals)
+    : ambulances(ambulances), suppliers(suppliers), clinics(clinics), hospitals(hospitals), finished(false) {}
+
+void MetricsExporter::setFinished() {
+    finished.store(true, std::memory_order_relaxed);
+}
+
+std::string MetricsExporter::render() {
+    std::vector<SellerSample> samples;
+    sample(samples, "ambulance", ambulances);
+    sample(samples, "supplier", suppliers);
+    sample(samples, "clinic", clinics);
+    sample(samples, "hospital", hospitals);
+
+    std::ostringstream out;
+
+    family(out, "pco_seller_funds", "gauge", "Money currently held by the seller");
+    for (const SellerSample& s : samples) {
+        out << "pco_seller_funds{" << labels(s.kind, s.id) << "} " << s.state.funds << "\n";
+    }
+
+    family(out, "pco_seller_stock", "gauge", "Units of each item currently in stock");
+    for (const SellerSample& s : samples) {
+        for (int item = 0; item < NB_ITEM_TYPES; ++item) {
+            if (s.state.has(static_cast<ItemType>(item))) {
+                out << "pco_seller_stock{" << labels(s.kind, s.id) << ",item=\"" << getItemName(static_cast<ItemType>(item)).toStdString()
+                    << "\"} " << s.state.stocks[item] << "\n";
+            }
+        }
+    }
+
+    family(out, "pco_seller_trades_total", "counter", "Sales and admissions offered to the seller, by outcome");
+    for (const SellerSample& s : samples) {
+        out << "pco_seller_trades_total{" << labels(s.kind, s.id) << ",outcome=\"accepted\"} " << s.accepted << "\n";
+        out << "pco_seller_trades_total{" << labels(s.kind, s.id) << ",outcome=\"refused\"} " << s.refused << "\n";
+    }
+
+    family(out, "pco_seller_cross_region_trades_total", "counter", "Purchases and transfers of the seller served by another region");
+    for (const SellerSample& s : samples) {
+        out << "pco_seller_cross_region_trades_total{" << labels(s.kind, s.id) << "} " << s.crossRegion << "\n";
+    }
+
+    family(out, "pco_seller_paid_to_workers_total", "counter", "Money paid to the seller's employees");
+    for (const SellerSample& s : samples) {
+        out << "pco_seller_paid_to_workers_total{" << labels(s.kind, s.id) << "} " << s.paidToWorkers << "\n";
+    }
+
+    // The world aggregates are computed over the values read for the per-seller series, each seller is read once
+    std::vector<int32_t> occupiedBeds;
+    std::vector<int32_t> beds;
+    family(out, "pco_hospital_beds_occupied", "gauge", "Beds currently occupied in the hospital");
+    for (Hospital* hospital : hospitals) {
+        occupiedBeds.push_back(hospital->getOccupiedBeds());
+        beds.push_back(hospital->getMaxBeds());
+        out << "pco_hospital_beds_occupied{" << labels("hospital", hospital->getUniqueId()) << "} "
+            << occupiedBeds.back() << "\n";
+    }
+
+    family(out, "pco_hospital_patients_discharged_total", "counter", "Healed patients discharged by the hospital");
+    for (Hospital* hospital : hospitals) {
+        out << "pco_hospital_patients_discharged_total{" << labels("hospital", hospital->getUniqueId()) << "} "
+            << hospital->getNumberDischarged() << "\n";
+    }
+
+    family(out, "pco_clinic_patients_treated_total", "counter", "Patients treated by the clinic");
+    for (Clinic* clinic : clinics) {
+        out << "pco_clinic_patients_treated_total{" << labels("clinic", clinic->getUniqueId()) << "} "
+            << clinic->getNumberTreated() << "\n";
+    }
+
+    std::vector<int32_t> funds;
+    std::vector<int32_t> patients;
+    for (const SellerSample& s : samples) {
+        funds.push_back(s.state.funds);
+        patients.push_back(s.patients);
+    }
+    int32_t minFunds = 0;
+    int32_t maxFunds = 0;
+    WorldKernels::minMax(funds.data(), funds.size(), minFunds, maxFunds);
+
+    family(out, "pco_world_funds", "gauge", "Money held by all the sellers together, and by the poorest and richest of them");
+    out << "pco_world_funds{aggregate=\"total\"} " << WorldKernels::sum(funds.data(), funds.size()) << "\n";
+    out << "pco_world_funds{aggregate=\"min\"} " << minFunds << "\n";
+    out << "pco_world_funds{aggregate=\"max\"} " << maxFunds << "\n";
+
+    family(out, "pco_world_patients", "gauge", "Patients held by all the sellers together");
+    out << "pco_world_patients " << WorldKernels::sum(patients.data(), patients.size()) << "\n";
+
+    family(out, "pco_world_hospitals_by_occupancy", "gauge", "Hospitals by share of occupied beds, labelled by the lower bound of the bin in percent, 100 for full hospitals");
+    std::array<uint64_t, WORLD_VIEW_OCCUPANCY_BINS + 1> bins;
+    WorldKernels::occupancyHistogram(occupiedBeds.data(), beds.data(), beds.size(), bins.data(), WORLD_VIEW_OCCUPANCY_BINS);
+    for (size_t bin = 0; bin < bins.size(); ++bin) {
+        out << "pco_world_hospitals_by_occupancy{bin=\"" << bin * 100 / WORLD_VIEW_OCCUPANCY_BINS << "\"} " << bins[bin] << "\n";
+    }
+
+    return out.str();
+}
+
+void MetricsExporter::writeFile(const std::string& metrics) {
+    std::string tmpPath = filePath + ".tmp";
+    FILE* file = std::fopen(tmpPath.c_str(), "w");
+    if (!file) {
+        std::cerr << "Cannot write the metrics " << tmpPath << std::endl;
+        return;
+    }
+    std::fwrite(metrics.data(), 1, metrics.size(), file);
+    std::fclose(file);
+    std::rename(tmpPath.c_str(), filePath.c_str());
+}
+
+int MetricsExporter::openSocket() {
+    sockaddr_un address{};
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Metrics socket path too long " << socketPath << std::endl;
+        return -1;
+    }
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener >= 0) {
+        ::unlink(socketPath.c_str());
+        if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0 && ::listen(listener, METRICS_BACKLOG) == 0) {
+            return listener;
+        }
+        ::close(listener);
+    }
+    std::cerr << "Cannot listen on the metrics socket " << socketPath << std::endl;
+    return -1;
+}
+
+void MetricsExporter::serveClients(int listener, int timeoutMs) {
+    pollfd pending{listener, POLLIN, 0};
+    if (::poll(&pending, 1, timeoutMs) <= 0) {
+        return;
+    }
+    int client = ::accept(listener, nullptr, nullptr);
+    if (client < 0) {
+        return;
+    }
+    std::string metrics = render();
+    size_t written = 0;
+    while (written < metrics.size()) {
+        ssize_t n = ::send(client, metrics.data() + written, metrics.size() - written, MSG_NOSIGNAL);
+        if (n <= 0) {
+            break;
+        }
+        written += n;
+    }
+    ::close(client);
+}
+
+void MetricsExporter::run() {
+    int listener = socketPath.empty() ? -1 : openSocket();
+    auto nextWrite = std::chrono::steady_clock::now();
+
+    while (!finished.load(std::memory_order_relaxed)) {
+        auto now = std::chrono::steady_clock::now();
+        if (!filePath.empty() && now >= nextWrite) {
+            writeFile(render());
+            nextWrite = now + std::chrono::milliseconds(METRICS_PERIOD_MS);
+        }
+
+        // The wait is bounded so that setFinished() is noticed within a period
+        int timeoutMs = METRICS_PERIOD_MS;
+        if (!filePath.empty()) {
+            timeoutMs = std::max<int>(0, std::chrono::duration_cast<std::chrono::milliseconds>(nextWrite - now).count());
+        }
+        if (listener >= 0) {
+            serveClients(listener, timeoutMs);
+        } else {
+            ::poll(nullptr, 0, timeoutMs);
+        }
+    }
+
+    if (!filePath.empty()) {
+        writeFile(render());
+    }
+    if (listener >= 0) {
+        ::close(listener);
+        ::unlink(socketPath.c_str());
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef METRICSEXPORTER_H
+#define METRICSEXPORTER_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <QString>
+
+#include "ambulance.h"
+#include "supplier.h"
+#include "clinic.h"
+#include "hospital.h"
+#include "worldView.h"
+
+#define METRICS_PERIOD_MS 1000  // Intervalle entre deux réécritures du fichier de métriques
+#define METRICS_BACKLOG 8       // Connexions en attente sur le socket de métriques
+
+/**
+ * @brief The MetricsExporter class
+ * Expose l'état des vendeurs au format texte de Prometheus pendant la simulation, sans l'interrompre :
+ * le fichier configuré est réécrit (fichier temporaire puis rename, la lecture voit toujours une version complète)
+ * toutes les METRICS_PERIOD_MS millisecondes, et chaque connexion au socket Unix configuré reçoit l'état courant.
+ * Les valeurs sont lues au moment de l'export : l'argent et les stocks dans l'instantané publié par chaque vendeur,
+ * les lits occupés sous le mutex de leur hôpital. Chaque vendeur est lu une seule fois par export, les agrégats du monde
+ * sont calculés sur les valeurs déjà lues pour les séries par vendeur.
+ */
+class MetricsExporter {
+public:
+    /**
+     * @brief configure
+     * @param filePath Fichier réécrit périodiquement, vide pour ne pas l'écrire
+     * @param socketPath Socket Unix servant les métriques à chaque connexion, vide pour ne pas l'ouvrir
+     * Doit être appelée avant la création de Utils.
+     */
+    static void configure(const QString& filePath, const QString& socketPath);
+
+    static bool isEnabled();
+
+    MetricsExporter(std::vector<Ambulance*> ambulances, std::vector<Supplier*> suppliers,
+                    std::vector<Clinic*> clinics, std::vector<Hospital*> hospitals);
+
+    /**
+     * @brief run
+     * Boucle d'export, écrit une dernière fois les métriques après setFinished()
+     */
+    void run();
+
+    void setFinished();
+
+    /**
+     * @brief render
+     * @return L'état courant des vendeurs au format texte de Prometheus
+     */
+    std::string render();
+
+private:
+    void writeFile(const std::string& metrics);
+
+    int openSocket();
+
+    void serveClients(int listener, int timeoutMs);
+
+    std::vector<Ambulance*> ambulances;
+    std::vector<Supplier*> suppliers;
+    std::vector<Clinic*> clinics;
+    std::vector<Hospital*> hospitals;
+
+    std::atomic<bool> finished;
+
+    static std::string filePath;
+    static std::string socketPath;
+};
+
+#endif // METRICSEXPORTER_H
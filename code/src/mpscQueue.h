@@ -0,0 +1,72 @@
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include <atomic>
+
+/**
+ * @brief The MpscQueue class
+ * Lock-free FIFO queue with any number of producers and a single consumer (Vyukov's algorithm).
+ * push() can be called from any thread, pop() and empty() only from the consumer thread.
+ */
+template<typename T>
+class MpscQueue {
+public:
+    MpscQueue() : head(new Node()), tail(head.load()) {}
+
+    ~MpscQueue() {
+        T value;
+        while (pop(value)) {}
+        delete tail;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    /**
+     * @brief push
+     * @param value The value to append at the end of the queue
+     */
+    void push(const T& value) {
+        Node* node = new Node(value);
+        Node* previous = head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    /**
+     * @brief pop
+     * @param value Receives the value at the front of the queue
+     * @return false if the queue is empty
+     */
+    bool pop(T& value) {
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        value = next->value;
+        delete tail;
+        tail = next;
+        return true;
+    }
+
+    /**
+     * @brief empty
+     * @return true if there is nothing to pop
+     */
+    bool empty() const {
+        return tail->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    struct Node {
+        Node() : value() {}
+        explicit Node(const T& value) : value(value) {}
+
+        T value;
+        std::atomic<Node*> next{nullptr};
+    };
+
+    std::atomic<Node*> head; // Last node pushed, shared by the producers
+    Node* tail;              // Sentinel before the next value, owned by the consumer
+};
+
+#endif // MPSCQUEUE_H
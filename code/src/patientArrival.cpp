@@ -0,0 +1,171 @@
+#include "patientArrival.h"
+#include <pcosynchro/pcothread.h>
+#include "replay.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+ArrivalProcess PatientArrivalGenerator::configuredProcess = ArrivalProcess::Poisson;
+double PatientArrivalGenerator::configuredRate = 0;
+std::vector<double> PatientArrivalGenerator::configuredTrace;
+
+bool PatientArrivalGenerator::configure(ArrivalProcess process, double ratePerSecond, const QString& tracePath) {
+    configuredProcess = process;
+    configuredRate = ratePerSecond;
+    configuredTrace.clear();
+    return process != ArrivalProcess::Trace || readTrace(tracePath, configuredTrace);
+}
+
+bool PatientArrivalGenerator::isEnabled() {
+    return configuredProcess == ArrivalProcess::Trace ? !configuredTrace.empty() : configuredRate > 0;
+}
+
+PatientArrivalGenerator::PatientArrivalGenerator(std::vector<Ambulance*> ambulances)
+    : PatientArrivalGenerator(ambulances, configuredProcess, configuredRate)
+{
+    trace = configuredTrace;
+}
+
+PatientArrivalGenerator::PatientArrivalGenerator(std::vector<Ambulance*> ambulances, ArrivalProcess process, double ratePerSecond)
+    : ambulances(ambulances),
+      process(process),
+      ratePerSecond(ratePerSecond),
+      traceIndex(0),
+      generator(),
+      nextAmbulance(0),
+      nbArrivals(0),
+      finished(false)
+{
+    for (Ambulance* ambulance : ambulances) {
+        ambulance->setOpenLoop(true);
+    }
+}
+
+bool PatientArrivalGenerator::readTrace(const QString& path, std::vector<double>& times) {
+    std::ifstream file(path.toStdString());
+    if (!file) {
+        std::cerr << "Cannot read the arrival trace " << path.toStdString() << std::endl;
+        return false;
+    }
+
+    times.clear();
+    double time;
+    while (file >> time) {
+        times.push_back(time);
+    }
+    std::sort(times.begin(), times.end());
+
+    if (times.empty()) {
+        std::cerr << "The arrival trace " << path.toStdString() << " has no arrival" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool PatientArrivalGenerator::loadTrace(const QString& path) {
+    traceIndex = 0;
+    return readTrace(path, trace);
+}
+
+int PatientArrivalGenerator::sampleArrivals(double seconds, uint32_t seed) {
+    generator.seed(seed);
+    traceIndex = 0;
+
+    int count = 0;
+    double time = 0;
+    int size;
+    for (double delay = nextArrival(size); delay >= 0 && time + delay <= seconds; delay = nextArrival(size)) {
+        time += delay;
+        count += size;
+    }
+    traceIndex = 0;
+    return count;
+}
+
+double PatientArrivalGenerator::nextArrival(int& size) {
+    size = 1;
+
+    switch (process) {
+        case ArrivalProcess::Poisson:
+            return std::exponential_distribution<double>(ratePerSecond)(generator);
+
+        case ArrivalProcess::Bursty: {
+            // Bursts are a Poisson process, with a geometric size keeping the mean rate at ratePerSecond
+            size = 1 + std::geometric_distribution<int>(1.0 / MEAN_BURST_SIZE)(generator);
+            return std::exponential_distribution<double>(ratePerSecond / MEAN_BURST_SIZE)(generator);
+        }
+
+        case ArrivalProcess::Trace: {
+            if (traceIndex >= trace.size()) {
+                return -1;
+            }
+            double previous = traceIndex > 0 ? trace[traceIndex - 1] : 0;
+            double delay = trace[traceIndex++] - previous;
+            while (traceIndex < trace.size() && trace[traceIndex] == trace[traceIndex - 1]) {
+                ++traceIndex;
+                ++size;
+            }
+            return std::max(0.0, delay);
+        }
+    }
+
+    return -1;
+}
+
+void PatientArrivalGenerator::dispatch(int size) {
+    ambulances[nextAmbulance]->admitArrivals(size);
+    nextAmbulance = (nextAmbulance + 1) % ambulances.size();
+    nbArrivals += size;
+}
+
+void PatientArrivalGenerator::run() {
+    if (ambulances.empty() || (process != ArrivalProcess::Trace && ratePerSecond <= 0)) {
+        std::cerr << "The patient arrival generator needs ambulances and a positive rate" << std::endl;
+        return;
+    }
+    if (process == ArrivalProcess::Trace && trace.empty()) {
+        std::cerr << "The patient arrival generator needs a loaded trace" << std::endl;
+        return;
+    }
+
+    Replay::setActor(REPLAY_GENERATOR_ACTOR);
+    generator.seed(Replay::random()());
+
+    // Arrivals are scheduled on absolute times, so the offered load does not drift with the sleeps
+    auto nextTime = std::chrono::steady_clock::now();
+
+    while (!finished) {
+        int size;
+        double delay = nextArrival(size);
+        if (delay < 0) {
+            break;
+        }
+        nextTime += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(delay));
+
+        auto now = std::chrono::steady_clock::now();
+        while (!finished && now < nextTime) {
+            auto wait = std::chrono::duration_cast<std::chrono::microseconds>(nextTime - now).count();
+            PcoThread::usleep(std::min<long long>(wait, MAX_ARRIVAL_SLEEP_US));
+            now = std::chrono::steady_clock::now();
+        }
+
+        ReplayTurn arrival(ReplayOp::Arrival);
+        if (finished) {
+            break;
+        }
+        dispatch(size);
+    }
+}
+
+void PatientArrivalGenerator::setFinished() {
+    finished = true;
+}
+
+int PatientArrivalGenerator::getNbArrivals() {
+    return nbArrivals;
+}
+
+double PatientArrivalGenerator::getRatePerSecond() {
+    return ratePerSecond;
+}
@@ -0,0 +1,133 @@
+#ifndef PATIENTARRIVAL_H
+#define PATIENTARRIVAL_H
+
+#include <vector>
+#include <random>
+#include <atomic>
+#include <QString>
+
+#include "ambulance.h"
+
+#define MEAN_BURST_SIZE 8           // Nombre moyen de patients par rafale en mode Bursty
+#define MAX_ARRIVAL_SLEEP_US 100000 // Durée maximale d'une attente, pour réagir rapidement à la fin du service
+
+/**
+ * @brief Processus d'arrivée des patients malades
+ * Poisson : arrivées indépendantes au taux cible
+ * Bursty : rafales de patients, arrivant selon un processus de Poisson, de taille moyenne MEAN_BURST_SIZE
+ * Trace : rejoue les instants d'arrivée lus dans un fichier
+ */
+enum class ArrivalProcess { Poisson, Bursty, Trace };
+
+/**
+ * @brief La classe PatientArrivalGenerator génère en continu des patients malades et les confie aux ambulances.
+ *        Elle remplace le stock initial fixe par une charge ouverte, pour mesurer un régime permanent.
+ */
+class PatientArrivalGenerator {
+public:
+    /**
+     * @brief configure
+     * @param process Processus d'arrivée
+     * @param ratePerSecond Taux d'arrivée moyen visé, 0 pour ne garder que le stock initial (ignoré en mode Trace)
+     * @param tracePath Fichier des instants d'arrivée, lu immédiatement en mode Trace
+     * @return false si la trace n'a pas pu être lue
+     * Doit être appelée avant la création de Utils.
+     */
+    static bool configure(ArrivalProcess process, double ratePerSecond, const QString& tracePath);
+
+    static bool isEnabled();
+
+    /**
+     * @brief Constructeur du générateur décrit par configure()
+     * @param ambulances Ambulances recevant les patients, à tour de rôle
+     */
+    explicit PatientArrivalGenerator(std::vector<Ambulance*> ambulances);
+
+    /**
+     * @brief Constructeur du générateur
+     * @param ambulances Ambulances recevant les patients, à tour de rôle
+     * @param process Processus d'arrivée
+     * @param ratePerSecond Taux d'arrivée moyen visé, en patients par seconde (ignoré en mode Trace)
+     */
+    PatientArrivalGenerator(std::vector<Ambulance*> ambulances, ArrivalProcess process, double ratePerSecond);
+
+    /**
+     * @brief loadTrace
+     * @param path Fichier contenant un instant d'arrivée par ligne, en secondes depuis le début du service
+     * @return false si le fichier n'a pas pu être lu ou ne contient aucune arrivée
+     */
+    bool loadTrace(const QString& path);
+
+    /**
+     * @brief sampleArrivals
+     * @param seconds Durée couverte par le tirage
+     * @param seed Graine du générateur
+     * @return Le nombre de patients arrivant pendant les seconds premières secondes, tirés sans attendre ni les confier
+     * Permet de vérifier un processus d'arrivée, le générateur doit être arrêté.
+     */
+    int sampleArrivals(double seconds, uint32_t seed);
+
+    /**
+     * @brief run
+     * La boucle principale du générateur, exécutée dans son propre thread jusqu'à la fin du service.
+     */
+    void run();
+
+    /**
+     * @brief setFinished
+     * Indique que le service est terminé et que le générateur doit s'arrêter
+     */
+    void setFinished();
+
+    /**
+     * @brief getNbArrivals
+     * @return Le nombre de patients générés depuis le début du service
+     */
+    int getNbArrivals();
+
+    /**
+     * @brief getRatePerSecond
+     * @return Le taux d'arrivée moyen visé
+     */
+    double getRatePerSecond();
+
+private:
+    /**
+     * @brief readTrace
+     * @param path Fichier contenant un instant d'arrivée par ligne
+     * @param times Reçoit les instants lus, triés
+     * @return false si le fichier n'a pas pu être lu ou ne contient aucune arrivée
+     */
+    static bool readTrace(const QString& path, std::vector<double>& times);
+
+    /**
+     * @brief nextArrival
+     * @param size Reçoit le nombre de patients arrivant ensemble
+     * @return Le temps avant la prochaine arrivée en secondes, négatif s'il n'y a plus d'arrivée
+     */
+    double nextArrival(int& size);
+
+    /**
+     * @brief dispatch
+     * @param size Nombre de patients à confier à la prochaine ambulance
+     */
+    void dispatch(int size);
+
+    std::vector<Ambulance*> ambulances; // Ambulances alimentées par le générateur
+    ArrivalProcess process;
+    double ratePerSecond;
+
+    std::vector<double> trace;          // Instants d'arrivée en mode Trace, triés
+    size_t traceIndex;
+
+    std::mt19937 generator;
+    size_t nextAmbulance;
+    std::atomic<int> nbArrivals;
+    std::atomic<bool> finished;
+
+    static ArrivalProcess configuredProcess;
+    static double configuredRate;
+    static std::vector<double> configuredTrace;
+};
+
+#endif // PATIENTARRIVAL_H
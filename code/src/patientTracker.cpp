@@ -0,0 +1,109 @@
+#include "patientTracker.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+std::atomic<PatientTracker::Chunk*> PatientTracker::chunks[PATIENT_MAX_CHUNKS] = {};
+std::atomic<PatientId> PatientTracker::nextId(0);
+
+static const auto trackerStart = std::chrono::steady_clock::now();
+
+uint32_t PatientTracker::now() {
+    auto elapsed = std::chrono::steady_clock::now() - trackerStart;
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()) + 1;
+}
+
+PatientTracker::Chunk* PatientTracker::getChunk(size_t index) {
+    Chunk* chunk = chunks[index].load(std::memory_order_acquire);
+    if (!chunk) {
+        Chunk* created = new Chunk();
+        if (chunks[index].compare_exchange_strong(chunk, created, std::memory_order_acq_rel)) {
+            chunk = created;
+        } else {
+            delete created;
+        }
+    }
+    return chunk;
+}
+
+PatientId PatientTracker::registerPatient() {
+    PatientId id = nextId.fetch_add(1, std::memory_order_relaxed);
+    if (id >= static_cast<PatientId>(PATIENT_CHUNK_SIZE) * PATIENT_MAX_CHUNKS) {
+        nextId.store(static_cast<PatientId>(PATIENT_CHUNK_SIZE) * PATIENT_MAX_CHUNKS, std::memory_order_relaxed);
+        return UNTRACKED;
+    }
+    getChunk(id / PATIENT_CHUNK_SIZE);
+    stamp(id, PatientStage::Arrived);
+    return id;
+}
+
+void PatientTracker::stamp(PatientId id, PatientStage stage) {
+    if (id == UNTRACKED) {
+        return;
+    }
+    Chunk* chunk = chunks[id / PATIENT_CHUNK_SIZE].load(std::memory_order_acquire);
+    chunk->times[static_cast<int>(stage)][id % PATIENT_CHUNK_SIZE].store(now(), std::memory_order_relaxed);
+}
+
+std::deque<PatientId>& PatientTracker::handoff() {
+    thread_local std::deque<PatientId> patients;
+    return patients;
+}
+
+QString PatientTracker::report() {
+    static const char* names[] = {
+        "Ambulance (arrival -> admission)",
+        "Hospital bed (admission -> clinic)",
+        "Clinic (clinic -> healed)",
+        "Transfer (healed -> rest)",
+        "Rest (rest -> discharge)",
+        "End to end (arrival -> discharge)"
+    };
+    const int nbStages = static_cast<int>(PatientStage::NbStages);
+    PatientId nbPatients = nextId.load(std::memory_order_relaxed);
+
+    QString report = QString("Patient latencies in ms over %1 patients :").arg(nbPatients);
+
+    for (int step = 0; step < nbStages; ++step) {
+        int from = step < nbStages - 1 ? step : static_cast<int>(PatientStage::Arrived);
+        int to = step < nbStages - 1 ? step + 1 : static_cast<int>(PatientStage::Discharged);
+
+        std::vector<uint32_t> durations;
+        for (PatientId id = 0; id < nbPatients; ++id) {
+            Chunk* chunk = chunks[id / PATIENT_CHUNK_SIZE].load(std::memory_order_acquire);
+            uint32_t start = chunk->times[from][id % PATIENT_CHUNK_SIZE].load(std::memory_order_relaxed);
+            uint32_t end = chunk->times[to][id % PATIENT_CHUNK_SIZE].load(std::memory_order_relaxed);
+            if (start && end >= start) {
+                durations.push_back(end - start);
+            }
+        }
+
+        if (durations.empty()) {
+            report += QString("\n  %1 : no patient").arg(names[step]);
+            continue;
+        }
+
+        std::sort(durations.begin(), durations.end());
+        auto percentile = [&durations](double p) {
+            return durations[std::min(durations.size() - 1, static_cast<size_t>(p * durations.size()))];
+        };
+        double mean = 0;
+        for (uint32_t duration : durations) {
+            mean += duration;
+        }
+        mean /= durations.size();
+
+        report += QString("\n  %1 : n=%2 mean=%3 p50=%4 p90=%5 p99=%6 max=%7")
+                      .arg(names[step]).arg(durations.size()).arg(mean, 0, 'f', 1)
+                      .arg(percentile(0.5)).arg(percentile(0.9)).arg(percentile(0.99)).arg(durations.back());
+    }
+
+    return report;
+}
+
+void PatientTracker::reset() {
+    for (auto& chunk : chunks) {
+        delete chunk.exchange(nullptr, std::memory_order_acq_rel);
+    }
+    nextId.store(0, std::memory_order_relaxed);
+}
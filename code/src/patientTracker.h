@@ -0,0 +1,81 @@
+#ifndef PATIENTTRACKER_H
+#define PATIENTTRACKER_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <QString>
+
+#define PATIENT_CHUNK_SIZE 4096     // Patients par bloc de timestamps
+#define PATIENT_MAX_CHUNKS 1024     // Nombre maximal de blocs, au-delà les patients ne sont plus suivis
+
+using PatientId = uint32_t;
+
+/**
+ * @brief Étapes du parcours d'un patient, dans l'ordre
+ */
+enum class PatientStage {
+    Arrived,    // Pris en charge par une ambulance
+    Admitted,   // Admis dans un lit d'hôpital
+    InClinic,   // Acheté par une clinique
+    Healed,     // Soigné par la clinique
+    Resting,    // De retour à l'hôpital pour sa convalescence
+    Discharged, // Sorti de l'hôpital
+    NbStages
+};
+
+/**
+ * @brief La classe PatientTracker attribue un identifiant à chaque patient et date chacune de ses étapes.
+ *        Les dates sont rangées par étape (structure de tableaux), un store relâché de 4 octets par transition.
+ *        Les identifiants circulent entre vendeurs par un tampon propre au thread qui effectue l'échange :
+ *        le vendeur y dépose les patients cédés, l'acheteur les reprend dans le même thread.
+ */
+class PatientTracker {
+public:
+    static constexpr PatientId UNTRACKED = UINT32_MAX;
+
+    /**
+     * @brief registerPatient
+     * @return Un nouvel identifiant, daté de l'étape Arrived, ou UNTRACKED si la capacité est atteinte
+     */
+    static PatientId registerPatient();
+
+    /**
+     * @brief stamp
+     * @param id Le patient
+     * @param stage L'étape atteinte maintenant
+     */
+    static void stamp(PatientId id, PatientStage stage);
+
+    /**
+     * @brief handoff
+     * @return Le tampon des patients en cours d'échange dans le thread appelant
+     */
+    static std::deque<PatientId>& handoff();
+
+    /**
+     * @brief report
+     * @return La distribution des durées passées entre chaque étape, pour tous les patients suivis
+     */
+    static QString report();
+
+    /**
+     * @brief reset
+     * Oublie tous les patients suivis et libère leurs blocs, aucun vendeur ne doit tourner
+     */
+    static void reset();
+
+private:
+    struct Chunk {
+        std::atomic<uint32_t> times[static_cast<int>(PatientStage::NbStages)][PATIENT_CHUNK_SIZE]; // ms depuis le début + 1, 0 si pas encore atteinte
+    };
+
+    static Chunk* getChunk(size_t index);
+
+    static uint32_t now();
+
+    static std::atomic<Chunk*> chunks[PATIENT_MAX_CHUNKS];
+    static std::atomic<PatientId> nextId;
+};
+
+#endif // PATIENTTRACKER_H
@@ -0,0 +1,205 @@
+#include "placement.h"
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <unordered_map>
+#include <sstream>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+AffinityMode Placement::mode = AffinityMode::None;
+std::vector<std::vector<int>> Placement::cpusByNode;
+std::vector<int> Placement::cpus;
+std::vector<int> Placement::nodes;
+uint64_t Placement::nbLinks = 0;
+uint64_t Placement::naiveCrossNodeLinks = 0;
+uint64_t Placement::plannedCrossNodeLinks = 0;
+
+namespace {
+
+/**
+ * @brief Lit une liste du noyau comme « 0-3,8,10-11 », vide si le fichier n'existe pas
+ */
+std::vector<int> readList(const std::string& path) {
+    std::ifstream file(path);
+    std::string list;
+    std::vector<int> values;
+    if (!(file >> list)) {
+        return values;
+    }
+    std::istringstream ranges(list);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        int first = 0;
+        int last = 0;
+        char dash = 0;
+        std::istringstream bounds(range);
+        bounds >> first;
+        last = (bounds >> dash >> last) ? last : first;
+        for (int value = first; value <= last; ++value) {
+            values.push_back(value);
+        }
+    }
+    return values;
+}
+
+}
+
+void Placement::configure(AffinityMode affinity) {
+    mode = affinity;
+    cpusByNode.clear();
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+
+    for (int node : readList("/sys/devices/system/node/online")) {
+        std::vector<int> nodeCpus;
+        for (int cpu : readList("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist")) {
+            if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+                nodeCpus.push_back(cpu);
+            }
+        }
+        if (!nodeCpus.empty()) {
+            cpusByNode.push_back(nodeCpus);
+        }
+    }
+
+    // Without NUMA information, the allowed cores form a single node
+    if (cpusByNode.empty()) {
+        cpusByNode.emplace_back();
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &allowed)) {
+                cpusByNode.back().push_back(cpu);
+            }
+        }
+    }
+}
+
+void Placement::setNodes(const std::vector<std::vector<int>>& nodeCpus) {
+    cpusByNode = nodeCpus;
+}
+
+void Placement::plan(const std::vector<Seller*>& sellers) {
+    std::vector<int> allCpus;
+    std::vector<int> nodeOfCpu;
+    for (size_t node = 0; node < cpusByNode.size(); ++node) {
+        allCpus.insert(allCpus.end(), cpusByNode[node].begin(), cpusByNode[node].end());
+        nodeOfCpu.insert(nodeOfCpu.end(), cpusByNode[node].size(), int(node));
+    }
+    if (allCpus.empty() || sellers.empty()) {
+        return;
+    }
+
+    std::unordered_map<Seller*, size_t> indices;
+    int maxId = 0;
+    for (size_t i = 0; i < sellers.size(); ++i) {
+        indices[sellers[i]] = i;
+        maxId = std::max(maxId, sellers[i]->getUniqueId());
+    }
+
+    // Trading is what moves cache lines between two entities, whichever of them buys
+    std::vector<std::vector<size_t>> neighbours(sellers.size());
+    std::vector<std::pair<size_t, size_t>> links;
+    for (size_t i = 0; i < sellers.size(); ++i) {
+        for (Seller* partner : sellers[i]->getTradingPartners()) {
+            auto it = indices.find(partner);
+            if (it != indices.end()) {
+                neighbours[i].push_back(it->second);
+                neighbours[it->second].push_back(i);
+                links.emplace_back(i, it->second);
+            }
+        }
+    }
+
+    std::vector<size_t> order;
+    std::vector<bool> visited(sellers.size(), false);
+    for (size_t seed = 0; seed < sellers.size(); ++seed) {
+        if (visited[seed]) {
+            continue;
+        }
+        std::deque<size_t> queue{seed};
+        visited[seed] = true;
+        while (!queue.empty()) {
+            size_t current = queue.front();
+            queue.pop_front();
+            order.push_back(current);
+            for (size_t next : neighbours[current]) {
+                if (!visited[next]) {
+                    visited[next] = true;
+                    queue.push_back(next);
+                }
+            }
+        }
+    }
+
+    // Consecutive entities of the traversal share a core, or at least a node
+    std::vector<size_t> plannedCpu(sellers.size());
+    for (size_t position = 0; position < order.size(); ++position) {
+        plannedCpu[order[position]] = position * allCpus.size() / order.size();
+    }
+
+    cpus.assign(maxId + 1, -1);
+    nodes.assign(maxId + 1, -1);
+    for (size_t i = 0; i < sellers.size(); ++i) {
+        cpus[sellers[i]->getUniqueId()] = allCpus[plannedCpu[i]];
+        nodes[sellers[i]->getUniqueId()] = nodeOfCpu[plannedCpu[i]];
+    }
+
+    nbLinks = links.size();
+    naiveCrossNodeLinks = 0;
+    plannedCrossNodeLinks = 0;
+    auto naiveNode = [&](size_t i) { return nodeOfCpu[sellers[i]->getUniqueId() % allCpus.size()]; };
+    for (const auto& link : links) {
+        naiveCrossNodeLinks += naiveNode(link.first) != naiveNode(link.second);
+        plannedCrossNodeLinks += nodeOfCpu[plannedCpu[link.first]] != nodeOfCpu[plannedCpu[link.second]];
+    }
+}
+
+void Placement::apply(int uniqueId) {
+    if (!isEnabled() || uniqueId < 0 || size_t(uniqueId) >= cpus.size() || cpus[uniqueId] < 0) {
+        return;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (mode == AffinityMode::Core) {
+        CPU_SET(cpus[uniqueId], &set);
+    } else {
+        for (int cpu : cpusByNode[nodes[uniqueId]]) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+    // The pages the thread touches from now on come from its node when possible, the kernel falls back to another one
+    std::vector<unsigned long> nodeMask(nodes[uniqueId] / (8 * sizeof(unsigned long)) + 1, 0);
+    nodeMask[nodes[uniqueId] / (8 * sizeof(unsigned long))] |= 1UL << (nodes[uniqueId] % (8 * sizeof(unsigned long)));
+    syscall(SYS_set_mempolicy, PLACEMENT_MPOL_PREFERRED, nodeMask.data(), nodeMask.size() * 8 * sizeof(unsigned long) + 1);
+}
+
+void Placement::reset() {
+    mode = AffinityMode::None;
+    cpusByNode.clear();
+    cpus.clear();
+    nodes.clear();
+    nbLinks = 0;
+    naiveCrossNodeLinks = 0;
+    plannedCrossNodeLinks = 0;
+}
+
+double Placement::getCrossNodeLinkShare() {
+    return nbLinks ? double(isEnabled() ? plannedCrossNodeLinks : naiveCrossNodeLinks) / nbLinks : 0.0;
+}
+
+QString Placement::report() {
+    if (nbLinks == 0) {
+        return "Placement : no trading links to place";
+    }
+    return QString("Placement : %1 nodes, %2 trading links, %3% of the links cross nodes when placed by identifier, %4% once placed "
+                   "(static share of links, not measured traffic)")
+        .arg(cpusByNode.size()).arg(nbLinks)
+        .arg(100.0 * naiveCrossNodeLinks / nbLinks, 0, 'f', 1)
+        .arg(100.0 * plannedCrossNodeLinks / nbLinks, 0, 'f', 1);
+}
@@ -0,0 +1,88 @@
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include <cstdint>
+#include <vector>
+#include <QString>
+
+#include "seller.h"
+
+#define PLACEMENT_MPOL_PREFERRED 1  // MPOL_PREFERRED de numaif.h, repris pour ne pas dépendre de libnuma
+
+/**
+ * @brief Placement des threads des entités
+ * None : l'ordonnanceur place les threads, Core : chaque thread est attaché à un cœur,
+ * Node : chaque thread est attaché aux cœurs de son nœud NUMA et l'ordonnanceur choisit parmi eux
+ */
+enum class AffinityMode { None, Core, Node };
+
+/**
+ * @brief The Placement class
+ * Place les entités qui échangent entre elles sur des cœurs voisins d'un même nœud NUMA. Les entités sont ordonnées
+ * par un parcours en largeur du graphe de leurs partenaires d'échange (getTradingPartners), puis réparties dans cet
+ * ordre en blocs contigus sur les cœurs, nœud après nœud. Chaque thread d'entité s'attache à son cœur ou à son nœud
+ * au lancement et y alloue de préférence sa mémoire.
+ * Sans placement, les threads ne sont pas attachés mais la part des liens traversant deux nœuds reste calculée.
+ * Cette part est statique : chaque lien compte une fois, quel que soit le nombre d'échanges qui l'empruntent.
+ */
+class Placement {
+public:
+    /**
+     * @brief configure
+     * @param mode Placement des threads, doit être appelée avant la création de Utils
+     * Lit les cœurs autorisés de chaque nœud dans /sys/devices/system/node, un seul nœud avec les cœurs autorisés sinon.
+     */
+    static void configure(AffinityMode mode);
+
+    /**
+     * @brief setNodes
+     * @param cpusByNode Cœurs de chaque nœud, remplace la topologie lue par configure
+     */
+    static void setNodes(const std::vector<std::vector<int>>& cpusByNode);
+
+    static bool isEnabled() { return mode != AffinityMode::None; }
+
+    /**
+     * @brief plan
+     * @param sellers Toutes les entités, reliées à leurs partenaires d'échange
+     * Calcule le cœur et le nœud de chaque entité, avant le lancement des threads. Le coût est linéaire en nombre de liens.
+     */
+    static void plan(const std::vector<Seller*>& sellers);
+
+    /**
+     * @brief apply
+     * @param uniqueId L'entité dont le thread courant exécute la routine
+     * Attache le thread courant au cœur ou au nœud de l'entité et y oriente ses allocations
+     */
+    static void apply(int uniqueId);
+
+    /**
+     * @brief getCrossNodeLinkShare
+     * @return La part des liens entre entités qui traversent deux nœuds avec le placement en vigueur, entre 0 et 1
+     */
+    static double getCrossNodeLinkShare();
+
+    /**
+     * @brief reset
+     * Oublie la topologie, le placement calculé et le mode, comme avant configure
+     */
+    static void reset();
+
+    /**
+     * @brief report
+     * @return La part des liens entre entités qui traversent deux nœuds, avec un placement par identifiant
+     *         (cœurs attribués à tour de rôle, comme un ordonnanceur qui répartit les threads) et avec le placement calculé
+     */
+    static QString report();
+
+private:
+    static AffinityMode mode;
+    static std::vector<std::vector<int>> cpusByNode;
+    static std::vector<int> cpus;           // Cœur de chaque entité, indexé par identifiant
+    static std::vector<int> nodes;          // Nœud de chaque entité, indexé par identifiant
+    static uint64_t nbLinks;
+    static uint64_t naiveCrossNodeLinks;
+    static uint64_t plannedCrossNodeLinks;
+};
+
+#endif // PLACEMENT_H
@@ -0,0 +1,189 @@
+#include "replay.h"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <pcosynchro/pcomutex.h>
+#include <pcosynchro/pcoconditionvariable.h>
+
+namespace {
+
+const char JOURNAL_MAGIC[4] = {'P', 'C', 'O', 'R'};
+const uint32_t JOURNAL_VERSION = 1;
+
+struct JournalHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t seed;
+    uint64_t nbEntries;
+};
+
+PcoMutex sequencer;                 // Jeton global de l'enregistrement
+PcoMutex replayMutex;               // Protège le curseur du rejeu
+PcoConditionVariable turnChanged;
+
+std::vector<uint32_t> journal;      // Entrées : acteur sur 24 bits, opération sur 8 bits
+size_t cursor = 0;
+bool diverged = false;
+uint64_t journalSeed = 0;
+std::string journalPath;
+
+thread_local int actor = -1;
+thread_local int depth = 0;
+thread_local bool sequenced = false;
+thread_local std::mt19937 generator;
+thread_local bool seeded = false;
+
+void seedThread() {
+    if (Replay::isActive()) {
+        std::seed_seq sequence{static_cast<uint32_t>(journalSeed), static_cast<uint32_t>(journalSeed >> 32), static_cast<uint32_t>(actor)};
+        generator.seed(sequence);
+    } else {
+        generator.seed(std::random_device{}());
+    }
+    seeded = true;
+}
+
+}
+
+std::atomic<ReplayMode> Replay::mode(ReplayMode::Off);
+
+void Replay::startRecording(const QString& path, uint64_t seed) {
+    journalPath = path.toStdString();
+    journalSeed = seed;
+    journal.clear();
+    mode.store(ReplayMode::Record, std::memory_order_relaxed);
+}
+
+bool Replay::startReplay(const QString& path) {
+    journalPath = path.toStdString();
+    FILE* file = std::fopen(journalPath.c_str(), "rb");
+    if (!file) {
+        std::cerr << "Cannot read the replay journal " << journalPath << std::endl;
+        return false;
+    }
+
+    JournalHeader header;
+    bool valid = std::fread(&header, sizeof(header), 1, file) == 1 &&
+                 std::equal(header.magic, header.magic + 4, JOURNAL_MAGIC) &&
+                 header.version == JOURNAL_VERSION;
+    if (valid) {
+        journal.resize(header.nbEntries);
+        valid = std::fread(journal.data(), sizeof(uint32_t), journal.size(), file) == journal.size();
+    }
+    std::fclose(file);
+
+    if (!valid) {
+        std::cerr << "Invalid replay journal " << journalPath << std::endl;
+        journal.clear();
+        return false;
+    }
+
+    journalSeed = header.seed;
+    cursor = 0;
+    diverged = false;
+    mode.store(ReplayMode::Replay, std::memory_order_relaxed);
+    return true;
+}
+
+void Replay::stop() {
+    mode.store(ReplayMode::Off, std::memory_order_relaxed);
+    journal.clear();
+    cursor = 0;
+    diverged = false;
+}
+
+uint64_t Replay::getSeed() {
+    return journalSeed;
+}
+
+void Replay::setActor(int actorId) {
+    actor = actorId;
+    seedThread();
+}
+
+std::mt19937& Replay::random() {
+    if (!seeded) {
+        seedThread();
+    }
+    return generator;
+}
+
+void Replay::acquire(ReplayOp op) {
+    // Threads that are not simulation actors (interface, exporters) are never ordered
+    if (actor < 0 || depth++ > 0) {
+        return;
+    }
+    uint32_t entry = (static_cast<uint32_t>(actor) << 8) | static_cast<uint8_t>(op);
+
+    if (getMode() == ReplayMode::Record) {
+        sequencer.lock();
+        journal.push_back(entry);
+        sequenced = true;
+        return;
+    }
+
+    replayMutex.lock();
+    while (!diverged && cursor < journal.size() && journal[cursor] != entry) {
+        size_t waitedFor = cursor;
+        if (!turnChanged.waitForSeconds(&replayMutex, REPLAY_STALL_SECONDS) && cursor == waitedFor && !diverged) {
+            std::cerr << "Replay diverged at operation " << cursor << " of " << journal.size() << std::endl;
+            diverged = true;
+            turnChanged.notifyAll();
+        }
+    }
+    // Once the journal is exhausted, the remaining operations run unordered until the threads stop
+    sequenced = !diverged && cursor < journal.size();
+    replayMutex.unlock();
+}
+
+void Replay::release() {
+    if (actor < 0 || --depth > 0) {
+        return;
+    }
+
+    if (getMode() == ReplayMode::Record) {
+        sequencer.unlock();
+    } else if (sequenced) {
+        replayMutex.lock();
+        ++cursor;
+        turnChanged.notifyAll();
+        replayMutex.unlock();
+    }
+    sequenced = false;
+}
+
+void Replay::flush() {
+    if (getMode() != ReplayMode::Record) {
+        return;
+    }
+
+    FILE* file = std::fopen(journalPath.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Cannot write the replay journal " << journalPath << std::endl;
+        return;
+    }
+    JournalHeader header{{JOURNAL_MAGIC[0], JOURNAL_MAGIC[1], JOURNAL_MAGIC[2], JOURNAL_MAGIC[3]},
+                         JOURNAL_VERSION, journalSeed, journal.size()};
+    std::fwrite(&header, sizeof(header), 1, file);
+    std::fwrite(journal.data(), sizeof(uint32_t), journal.size(), file);
+    std::fclose(file);
+}
+
+QString Replay::report() {
+    switch (getMode()) {
+        case ReplayMode::Record :
+            return QString("Replay journal : recorded %1 operations with seed %2")
+                .arg(static_cast<unsigned long long>(journal.size()))
+                .arg(static_cast<unsigned long long>(journalSeed));
+        case ReplayMode::Replay :
+            return QString("Replay journal : replayed %1 of %2 operations with seed %3%4")
+                .arg(static_cast<unsigned long long>(cursor))
+                .arg(static_cast<unsigned long long>(journal.size()))
+                .arg(static_cast<unsigned long long>(journalSeed))
+                .arg(diverged ? " (diverged)" : "");
+        default :
+            return "";
+    }
+}
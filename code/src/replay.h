@@ -0,0 +1,120 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <QString>
+
+#define REPLAY_GENERATOR_ACTOR 0xFFFFFE     // Acteur du générateur d'arrivées dans le journal
+#define REPLAY_CONTROL_ACTOR 0xFFFFFF       // Acteur du thread qui termine le service
+#define REPLAY_STALL_SECONDS 5              // Sans progrès pendant ce délai, le rejeu est considéré comme divergent
+
+enum class ReplayMode { Off, Record, Replay };
+
+/**
+ * @brief Opérations ordonnées par le journal
+ * Step : lecture du drapeau de fin en tête de boucle, Lock : section critique d'un vendeur,
+ * Choose : lecture des stocks d'autres vendeurs, Notify : annonce d'un patient soigné,
+ * Arrival : arrivée de patients, Admit : prise en charge des arrivées par l'ambulance, End : fin du service
+ */
+enum class ReplayOp : uint8_t { Step, Lock, Choose, Notify, Arrival, Admit, End };
+
+/**
+ * @brief The Replay class
+ * Enregistrement et rejeu déterministes d'une simulation. En enregistrement, les opérations qui touchent à l'état
+ * partagé prennent tour à tour un jeton global et sont ajoutées au journal (acteur et opération sur 32 bits) ;
+ * en rejeu, chaque opération attend que l'entrée courante du journal soit la sienne. Les tirages aléatoires
+ * viennent d'un générateur par thread dérivé de la graine du journal et de l'acteur.
+ * Hors enregistrement et rejeu, le coût d'une opération est une lecture atomique.
+ */
+class Replay {
+public:
+    /**
+     * @brief startRecording
+     * @param path Journal binaire écrit par flush()
+     * @param seed Graine des générateurs aléatoires des threads
+     * Doit être appelée avant le lancement des threads.
+     */
+    static void startRecording(const QString& path, uint64_t seed);
+
+    /**
+     * @brief startReplay
+     * @param path Journal écrit par un enregistrement
+     * @return false si le journal ne peut pas être lu
+     * Doit être appelée avant le lancement des threads.
+     */
+    static bool startReplay(const QString& path);
+
+    /**
+     * @brief stop
+     * Arrête l'enregistrement ou le rejeu sans écrire le journal, les threads doivent être terminés
+     */
+    static void stop();
+
+    static ReplayMode getMode() { return mode.load(std::memory_order_relaxed); }
+
+    static bool isActive() { return getMode() != ReplayMode::Off; }
+
+    static uint64_t getSeed();
+
+    /**
+     * @brief setActor
+     * @param actorId Identifiant sous lequel les opérations du thread courant sont journalisées
+     * Réinitialise aussi le générateur aléatoire du thread à partir de la graine et de l'acteur.
+     */
+    static void setActor(int actorId);
+
+    /**
+     * @brief random
+     * @return Le générateur aléatoire du thread courant
+     */
+    static std::mt19937& random();
+
+    /**
+     * @brief enter
+     * Prend le tour de l'opération pour le thread courant, les appels imbriqués ne prennent qu'un tour
+     */
+    static void enter(ReplayOp op) {
+        if (isActive()) {
+            acquire(op);
+        }
+    }
+
+    static void leave() {
+        if (isActive()) {
+            release();
+        }
+    }
+
+    /**
+     * @brief flush
+     * Écrit le journal enregistré, les threads doivent être terminés
+     */
+    static void flush();
+
+    /**
+     * @brief report
+     * @return Le nombre d'opérations enregistrées ou rejouées
+     */
+    static QString report();
+
+private:
+    static void acquire(ReplayOp op);
+
+    static void release();
+
+    static std::atomic<ReplayMode> mode;
+};
+
+/**
+ * @brief The ReplayTurn class
+ * Tour de journal couvrant la portée courante
+ */
+class ReplayTurn {
+public:
+    explicit ReplayTurn(ReplayOp op) { Replay::enter(op); }
+    ~ReplayTurn() { Replay::leave(); }
+};
+
+#endif // REPLAY_H
@@ -0,0 +1,144 @@
+#include "sampleFormat.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+const char SampleFormat::MAGIC[8] = {'P', 'C', 'O', 'S', 'M', 'P', 'L', '1'};
+
+namespace {
+
+/**
+ * @brief Curseur de lecture sur le contenu du fichier, toute lecture hors limites le rend invalide
+ */
+struct Cursor {
+    const uint8_t* position;
+    const uint8_t* end;
+    bool valid = true;
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (position >= end) {
+                valid = false;
+                return 0;
+            }
+            uint8_t byte = *position++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        valid = false;
+        return 0;
+    }
+
+    std::string string() {
+        uint64_t length = varint();
+        if (!valid || length > static_cast<uint64_t>(end - position)) {
+            valid = false;
+            return "";
+        }
+        std::string text(reinterpret_cast<const char*>(position), length);
+        position += length;
+        return text;
+    }
+};
+
+bool decodeColumn(Cursor& cursor, uint64_t nbSamples, std::vector<int64_t>& values) {
+    uint64_t length = cursor.varint();
+    if (!cursor.valid || length > static_cast<uint64_t>(cursor.end - cursor.position)) {
+        return false;
+    }
+    Cursor column{cursor.position, cursor.position + length};
+    cursor.position += length;
+
+    int64_t value = 0;
+    uint64_t decoded = 0;
+    while (decoded < nbSamples) {
+        uint64_t token = column.varint();
+        uint64_t repeat = 1;
+        if (token == 0) {
+            // Compared with the samples left, a corrupt count can neither wrap around nor allocate past the block
+            uint64_t extra = column.varint();
+            if (extra >= nbSamples - decoded) {
+                return false;
+            }
+            repeat += extra;
+        }
+        if (!column.valid) {
+            return false;
+        }
+        value += SampleFormat::unzigzag(token);
+        values.insert(values.end(), repeat, value);
+        decoded += repeat;
+    }
+    return true;
+}
+
+}
+
+bool SampleReader::open(const QString& path) {
+    std::ifstream file(path.toStdString(), std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::vector<uint8_t> content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if (content.size() < sizeof(SampleFormat::MAGIC) || std::memcmp(content.data(), SampleFormat::MAGIC, sizeof(SampleFormat::MAGIC)) != 0) {
+        return false;
+    }
+    Cursor cursor{content.data() + sizeof(SampleFormat::MAGIC), content.data() + content.size()};
+
+    if (cursor.varint() != SAMPLE_FORMAT_VERSION) {
+        return false;
+    }
+    periodMs = static_cast<int>(cursor.varint());
+
+    // Every name and seller takes at least a byte, a larger count is corrupt
+    uint64_t nbItems = cursor.varint();
+    if (!cursor.valid || nbItems > static_cast<uint64_t>(cursor.end - cursor.position)) {
+        return false;
+    }
+    itemNames.resize(nbItems);
+    for (std::string& name : itemNames) {
+        name = cursor.string();
+    }
+    uint64_t nbSellers = cursor.varint();
+    if (!cursor.valid || nbSellers > static_cast<uint64_t>(cursor.end - cursor.position)) {
+        return false;
+    }
+    sellers.resize(nbSellers);
+    for (SellerInfo& seller : sellers) {
+        seller.id = static_cast<int>(cursor.varint());
+        seller.kind = cursor.string();
+    }
+    if (!cursor.valid) {
+        return false;
+    }
+
+    size_t nbColumns = sellers.size() * (itemNames.size() + 1);
+    columns.assign(nbColumns, {});
+    timestamps.clear();
+
+    // Blocks are decoded into temporaries, a block cut short by the end of a run is dropped as a whole
+    while (cursor.position < cursor.end) {
+        uint64_t nbSamples = cursor.varint();
+        if (nbSamples > SAMPLE_FORMAT_MAX_BLOCK_SAMPLES) {
+            break;
+        }
+        std::vector<int64_t> blockTimestamps;
+        std::vector<std::vector<int64_t>> blockColumns(nbColumns);
+        bool complete = cursor.valid && decodeColumn(cursor, nbSamples, blockTimestamps);
+        for (size_t i = 0; complete && i < nbColumns; ++i) {
+            complete = decodeColumn(cursor, nbSamples, blockColumns[i]);
+        }
+        if (!complete) {
+            break;
+        }
+        timestamps.insert(timestamps.end(), blockTimestamps.begin(), blockTimestamps.end());
+        for (size_t i = 0; i < nbColumns; ++i) {
+            columns[i].insert(columns[i].end(), blockColumns[i].begin(), blockColumns[i].end());
+        }
+    }
+    return true;
+}
@@ -0,0 +1,135 @@
+#ifndef SAMPLEFORMAT_H
+#define SAMPLEFORMAT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <QString>
+
+/**
+ * Format des échantillons d'état (PCO_SAMPLES) :
+ * en-tête  : "PCOSMPL1", puis en varints la version, la période en ms, les noms des items et les vendeurs (id, type)
+ * blocs    : nombre d'échantillons, puis une colonne d'instants en ms et une colonne par vendeur et par grandeur
+ *            (argent puis stock de chaque item), chacune précédée de sa taille en octets
+ * colonnes : différences successives en zigzag varint, la première par rapport à 0 pour que chaque bloc se lise seul ;
+ *            une différence nulle est suivie du nombre de différences nulles supplémentaires
+ */
+
+#define SAMPLE_FORMAT_VERSION 1
+#define SAMPLE_FORMAT_MAX_BLOCK_SAMPLES (1 << 20)  // Au-delà, un bloc est considéré comme corrompu par le lecteur
+
+namespace SampleFormat {
+
+extern const char MAGIC[8];
+
+inline void writeVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+inline uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+/**
+ * @brief The ColumnEncoder class
+ * Encode une colonne d'un bloc au fil des échantillons
+ */
+class ColumnEncoder {
+public:
+    void append(int64_t value) {
+        int64_t delta = value - previous;
+        previous = value;
+        if (delta == 0) {
+            ++zeros;
+            return;
+        }
+        flushZeros();
+        writeVarint(bytes, zigzag(delta));
+    }
+
+    /**
+     * @brief finish
+     * @return Les octets de la colonne, l'encodeur est remis à zéro pour le bloc suivant
+     */
+    std::vector<uint8_t> finish() {
+        flushZeros();
+        std::vector<uint8_t> column;
+        column.swap(bytes);
+        previous = 0;
+        return column;
+    }
+
+private:
+    void flushZeros() {
+        if (zeros > 0) {
+            writeVarint(bytes, 0);
+            writeVarint(bytes, zeros - 1);
+            zeros = 0;
+        }
+    }
+
+    std::vector<uint8_t> bytes;
+    int64_t previous = 0;
+    uint64_t zeros = 0;
+};
+
+}
+
+/**
+ * @brief The SampleReader class
+ * Charge un fichier d'échantillons en colonnes décodées, pour l'analyse hors ligne
+ */
+class SampleReader {
+public:
+    struct SellerInfo {
+        int id;
+        std::string kind;
+    };
+
+    /**
+     * @brief open
+     * @param path Fichier écrit par StateSampler
+     * @return false si le fichier n'est pas valide, les blocs à partir du premier tronqué ou corrompu sont ignorés
+     */
+    bool open(const QString& path);
+
+    int getPeriodMs() const { return periodMs; }
+    const std::vector<std::string>& getItemNames() const { return itemNames; }
+    const std::vector<SellerInfo>& getSellers() const { return sellers; }
+
+    /**
+     * @brief getTimestamps
+     * @return L'instant de chaque échantillon, en ms depuis le début de l'échantillonnage
+     */
+    const std::vector<int64_t>& getTimestamps() const { return timestamps; }
+
+    /**
+     * @brief getFunds
+     * @param seller Indice du vendeur dans getSellers()
+     */
+    const std::vector<int64_t>& getFunds(size_t seller) const { return columns[seller * (itemNames.size() + 1)]; }
+
+    /**
+     * @brief getStock
+     * @param seller Indice du vendeur dans getSellers()
+     * @param item Indice de l'item dans getItemNames()
+     */
+    const std::vector<int64_t>& getStock(size_t seller, size_t item) const { return columns[seller * (itemNames.size() + 1) + 1 + item]; }
+
+private:
+    int periodMs = 0;
+    std::vector<std::string> itemNames;
+    std::vector<SellerInfo> sellers;
+    std::vector<int64_t> timestamps;
+    std::vector<std::vector<int64_t>> columns;
+};
+
+#endif // SAMPLEFORMAT_H
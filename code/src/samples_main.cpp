@@ -0,0 +1,53 @@
+#include <cstdio>
+
+#include "sampleFormat.h"
+
+/**
+ * pco_samples <échantillons> [sortie.csv]
+ * Écrit les échantillons d'état en CSV (time_ms,seller,kind,funds puis une colonne par item),
+ * une ligne par vendeur et par échantillon, sur la sortie standard si aucun fichier n'est donné.
+ */
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage : %s <samples> [output.csv]\n", argv[0]);
+        return 1;
+    }
+
+    SampleReader reader;
+    if (!reader.open(argv[1])) {
+        std::fprintf(stderr, "%s is not a valid samples file\n", argv[1]);
+        return 1;
+    }
+
+    FILE* output = argc > 2 ? std::fopen(argv[2], "w") : stdout;
+    if (!output) {
+        std::fprintf(stderr, "Cannot write %s\n", argv[2]);
+        return 1;
+    }
+
+    std::fprintf(output, "time_ms,seller,kind,funds");
+    for (const std::string& name : reader.getItemNames()) {
+        std::fprintf(output, ",%s", name.c_str());
+    }
+    std::fprintf(output, "\n");
+
+    const std::vector<int64_t>& timestamps = reader.getTimestamps();
+    for (size_t sample = 0; sample < timestamps.size(); ++sample) {
+        for (size_t seller = 0; seller < reader.getSellers().size(); ++seller) {
+            std::fprintf(output, "%lld,%d,%s,%lld", static_cast<long long>(timestamps[sample]),
+                         reader.getSellers()[seller].id, reader.getSellers()[seller].kind.c_str(),
+                         static_cast<long long>(reader.getFunds(seller)[sample]));
+            for (size_t item = 0; item < reader.getItemNames().size(); ++item) {
+                std::fprintf(output, ",%lld", static_cast<long long>(reader.getStock(seller, item)[sample]));
+            }
+            std::fprintf(output, "\n");
+        }
+    }
+
+    if (output != stdout) {
+        std::fclose(output);
+    }
+    return 0;
+}
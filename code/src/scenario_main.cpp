@@ -0,0 +1,250 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "utils.h"
+#include "iwindowinterface.h"
+
+/**
+ * pco_scenario_bench [--scenarios 3/3/2,300/300/200] [--csv résultats.csv] [--baseline référence.csv]
+ *                    [--threshold 0.10] [--timeout 300] [--affinity none|core|node]
+ * Lance chaque configuration (fournisseurs/cliniques/hôpitaux, ou fichier de scénario décrit dans topology.h) sans
+ * interface jusqu'à ce que tous les patients initiaux soient sortis de l'hôpital, et écrit une ligne CSV par configuration. Avec --baseline, échoue si le débit
+ * en patients par seconde d'une configuration est inférieur de plus de threshold à celui de la référence.
+ * --affinity place les threads des entités (voir placement.h). La colonne cross_node_link_share est la part des liens
+ * d'échange qui traversent deux nœuds, calculée sur le graphe au lancement : ce n'est pas le trafic mesuré.
+ */
+
+#define SCENARIO_DEFAULT_LIST "3/3/2,300/300/200"
+#define SCENARIO_DEFAULT_THRESHOLD 0.10     // Baisse de débit tolérée par rapport à la référence
+#define SCENARIO_DEFAULT_TIMEOUT_S 300      // Une configuration qui n'a pas fini à temps est marquée incomplète
+#define SCENARIO_POLL_MS 10                 // Intervalle de vérification des patients sortis
+
+#define SCENARIO_CSV_HEADER "scenario,suppliers,clinics,hospitals,patients,discharged,completed,wall_s,patients_per_s,trades_accepted,trades_refused,refusal_rate,peak_rss_kb,cross_region_trades,cross_node_link_share"
+
+/**
+ * @brief The HeadlessInterface class
+ * Interface sans affichage ni travail simulé : seules les synchronisations et les calculs des entités prennent du temps.
+ * Les boucles des entités comptent sur simulateWork pour céder le processeur, il est cédé sans attendre.
+ */
+class HeadlessInterface : public IWindowInterface {
+public:
+    void consoleAppendText(unsigned int consoleId, QString text) override {}
+    void updateFund(unsigned int id, unsigned new_fund) override {}
+    void updateStock(unsigned int id, std::map<ItemType, int>* stocks) override {}
+    void setLink(int from, int to) override {}
+    void setUtils(Utils* utils) override {}
+    void simulateWork() override { std::this_thread::yield(); }
+};
+
+struct Scenario {
+    std::string name;
+    int nbSuppliers;
+    int nbClinics;
+    int nbHospitals;
+    bool fromFile;                  // Déploiement lu depuis le fichier name plutôt que la topologie de utils.cpp
+    TopologySpec spec;
+};
+
+struct ScenarioResult {
+    int patients;
+    int discharged;
+    int completed;
+    double wallSeconds;
+    unsigned long long tradesAccepted;
+    unsigned long long tradesRefused;
+    unsigned long long tradesCrossRegion;
+    double crossNodeLinks;
+};
+
+std::vector<Scenario> parseScenarios(const std::string& list) {
+    std::vector<Scenario> scenarios;
+    size_t start = 0;
+    while (start < list.size()) {
+        size_t end = list.find(',', start);
+        std::string name = list.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        Scenario scenario{name, 0, 0, 0, false, {}};
+        if (std::sscanf(name.c_str(), "%d/%d/%d", &scenario.nbSuppliers, &scenario.nbClinics, &scenario.nbHospitals) == 3) {
+            scenarios.push_back(scenario);
+        } else if (scenario.spec.load(QString::fromStdString(name))) {
+            scenario.fromFile = true;
+            scenario.nbSuppliers = scenario.spec.getNbSuppliers();
+            scenario.nbClinics = scenario.spec.getNbClinics();
+            scenario.nbHospitals = scenario.spec.nbHospitals;
+            scenarios.push_back(scenario);
+        } else {
+            std::fprintf(stderr, "Ignoring the scenario %s, expected suppliers/clinics/hospitals or a scenario file\n", name.c_str());
+        }
+        start = end == std::string::npos ? list.size() : end + 1;
+    }
+    return scenarios;
+}
+
+/**
+ * @brief runScenario
+ * Exécuté dans un processus fils, pour que le pic de mémoire mesuré ne soit que celui de cette configuration
+ */
+ScenarioResult runScenario(const Scenario& scenario, int timeoutSeconds) {
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::seconds(timeoutSeconds);
+
+    std::unique_ptr<Utils> created = scenario.fromFile ? std::make_unique<Utils>(scenario.spec)
+                                                       : std::make_unique<Utils>(scenario.nbSuppliers, scenario.nbClinics, scenario.nbHospitals);
+    Utils& utils = *created;
+    ScenarioResult result{};
+    result.patients = utils.getInitialPatients();
+    while (utils.getNumberDischarged() < result.patients && std::chrono::steady_clock::now() < deadline) {
+        PcoThread::usleep(SCENARIO_POLL_MS * 1000);
+    }
+    result.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    utils.externalEndService();
+    result.discharged = utils.getNumberDischarged();
+    result.crossNodeLinks = Placement::getCrossNodeLinkShare();
+    result.completed = result.discharged >= result.patients;
+    for (Seller* seller : utils.getSellers()) {
+        result.tradesAccepted += seller->getTradesAccepted();
+        result.tradesRefused += seller->getTradesRefused();
+        result.tradesCrossRegion += seller->getTradesCrossRegion();
+    }
+    return result;
+}
+
+/**
+ * @brief loadBaseline
+ * @return Le débit en patients par seconde de chaque configuration de la référence
+ */
+std::map<std::string, double> loadBaseline(const char* path) {
+    std::map<std::string, double> baseline;
+    FILE* file = std::fopen(path, "r");
+    if (!file) {
+        std::fprintf(stderr, "Cannot read the baseline %s\n", path);
+        std::exit(1);
+    }
+    char line[1024];
+    while (std::fgets(line, sizeof(line), file)) {
+        std::vector<std::string> fields;
+        for (char* field = std::strtok(line, ",\n"); field; field = std::strtok(nullptr, ",\n")) {
+            fields.push_back(field);
+        }
+        // patients_per_s is the 9th column, the header line does not parse as a number
+        char* end = nullptr;
+        double throughput = fields.size() > 8 ? std::strtod(fields[8].c_str(), &end) : 0;
+        if (end && *end == '\0' && end != fields[8].c_str()) {
+            baseline[fields[0]] = throughput;
+        }
+    }
+    std::fclose(file);
+    return baseline;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string list = SCENARIO_DEFAULT_LIST;
+    const char* csvPath = nullptr;
+    const char* baselinePath = nullptr;
+    double threshold = SCENARIO_DEFAULT_THRESHOLD;
+    int timeoutSeconds = SCENARIO_DEFAULT_TIMEOUT_S;
+    AffinityMode affinity = AffinityMode::None;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--scenarios")) {
+            list = argv[i + 1];
+        } else if (!std::strcmp(argv[i], "--csv")) {
+            csvPath = argv[i + 1];
+        } else if (!std::strcmp(argv[i], "--baseline")) {
+            baselinePath = argv[i + 1];
+        } else if (!std::strcmp(argv[i], "--threshold")) {
+            threshold = std::atof(argv[i + 1]);
+        } else if (!std::strcmp(argv[i], "--timeout")) {
+            timeoutSeconds = std::atoi(argv[i + 1]);
+        } else if (!std::strcmp(argv[i], "--affinity")) {
+            affinity = !std::strcmp(argv[i + 1], "core") ? AffinityMode::Core :
+                       !std::strcmp(argv[i + 1], "node") ? AffinityMode::Node : AffinityMode::None;
+        } else {
+            std::fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (baselinePath) {
+        baseline = loadBaseline(baselinePath);
+    }
+
+    FILE* csv = csvPath ? std::fopen(csvPath, "w") : stdout;
+    if (!csv) {
+        std::fprintf(stderr, "Cannot write %s\n", csvPath);
+        return 1;
+    }
+    std::fprintf(csv, "%s\n", SCENARIO_CSV_HEADER);
+
+    Placement::configure(affinity);
+
+    HeadlessInterface interface;
+    SellerInterface::setInterface(&interface);
+
+    bool regressed = false;
+    for (const Scenario& scenario : parseScenarios(list)) {
+        std::fflush(csv);
+        int channel[2];
+        if (::pipe(channel) != 0) {
+            std::perror("pipe");
+            return 1;
+        }
+
+        pid_t child = ::fork();
+        if (child == 0) {
+            ::close(channel[0]);
+            // The entities' own output must not end up in the CSV written on stdout
+            ::dup2(STDERR_FILENO, STDOUT_FILENO);
+            ScenarioResult result = runScenario(scenario, timeoutSeconds);
+            bool sent = ::write(channel[1], &result, sizeof(result)) == sizeof(result);
+            ::_exit(sent ? 0 : 1);
+        }
+        ::close(channel[1]);
+
+        ScenarioResult result;
+        bool received = child > 0 && ::read(channel[0], &result, sizeof(result)) == sizeof(result);
+        ::close(channel[0]);
+        struct rusage usage{};
+        int status = 0;
+        if (child > 0) {
+            ::wait4(child, &status, 0, &usage);
+        }
+        if (!received) {
+            std::fprintf(stderr, "The scenario %s did not report a result\n", scenario.name.c_str());
+            regressed = true;
+            continue;
+        }
+
+        unsigned long long trades = result.tradesAccepted + result.tradesRefused;
+        double throughput = result.discharged / result.wallSeconds;
+        std::fprintf(csv, "%s,%d,%d,%d,%d,%d,%d,%.3f,%.1f,%llu,%llu,%.4f,%ld,%llu,%.4f\n", scenario.name.c_str(),
+                     scenario.nbSuppliers, scenario.nbClinics, scenario.nbHospitals, result.patients, result.discharged,
+                     result.completed, result.wallSeconds, throughput, result.tradesAccepted, result.tradesRefused,
+                     trades ? double(result.tradesRefused) / trades : 0.0, usage.ru_maxrss, result.tradesCrossRegion,
+                     result.crossNodeLinks);
+
+        auto reference = baseline.find(scenario.name);
+        if (reference != baseline.end() && throughput < reference->second * (1 - threshold)) {
+            std::fprintf(stderr, "Regression on %s : %.1f patients/s against %.1f in the baseline (threshold %.0f%%)\n",
+                         scenario.name.c_str(), throughput, reference->second, threshold * 100);
+            regressed = true;
+        }
+    }
+
+    if (csv != stdout) {
+        std::fclose(csv);
+    }
+    return regressed ? 1 : 0;
+}
@@ -1,23 +1,107 @@
 #include "seller.h"
+#include "checkpoint.h"
 #include <algorithm>
 #include <random>
 #include <cassert>
+#include <thread>
 
-Seller *Seller::chooseRandomSeller(std::vector<Seller *> &sellers) {
+Seller *Seller::chooseRandomSeller(const std::vector<Seller *> &sellers) {
     assert(sellers.size());
     std::vector<Seller*> out;
     std::sample(sellers.begin(), sellers.end(), std::back_inserter(out),
-            1, std::mt19937{std::random_device{}()});
+            1, Replay::random());
     return out.front();
 }
 
+Seller *Seller::chooseRandomSellerWith(const std::vector<Seller *> &sellers, ItemType item, int qty, int region) {
+    // The other sellers' stocks are read from their snapshots without their mutex, the read is ordered when recording or replaying
+    ReplayTurn choose(ReplayOp::Choose);
+    std::vector<Seller*> candidates;
+    std::vector<Seller*> remoteCandidates;
+    for (Seller* seller : sellers) {
+        SellerSnapshot snapshot = seller->getSnapshot();
+        if (snapshot.has(item) && snapshot.getStock(item) >= qty) {
+            (region == ANY_REGION || seller->region == region ? candidates : remoteCandidates).push_back(seller);
+        }
+    }
+    if (candidates.empty()) {
+        candidates.swap(remoteCandidates);
+    }
+    if (candidates.empty()) {
+        return nullptr;
+    }
+    return chooseRandomSeller(candidates);
+}
+
+std::map<ItemType, int> SellerSnapshot::toMap() const {
+    std::map<ItemType, int> map;
+    for (int item = 0; item < NB_ITEM_TYPES; ++item) {
+        if (has(static_cast<ItemType>(item))) {
+            map[static_cast<ItemType>(item)] = stocks[item];
+        }
+    }
+    return map;
+}
+
+SellerSnapshot Seller::getSnapshot() const {
+    SellerSnapshot snapshot;
+    while (true) {
+        uint32_t sequence = snapshotSequence.load(std::memory_order_acquire);
+        if (sequence & 1) {
+            // The seller is publishing, it only has a few stores left
+            std::this_thread::yield();
+            continue;
+        }
+        snapshot.funds = snapshotFunds.load(std::memory_order_relaxed);
+        snapshot.items = snapshotItems.load(std::memory_order_relaxed);
+        for (int item = 0; item < NB_ITEM_TYPES; ++item) {
+            snapshot.stocks[item] = snapshotStocks[item].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (snapshotSequence.load(std::memory_order_relaxed) == sequence) {
+            return snapshot;
+        }
+    }
+}
+
+void Seller::publishSnapshot() {
+    // Gathered before the sequence turns odd, so that readers retry for as short a time as possible
+    uint32_t items = 0;
+    std::array<int, NB_ITEM_TYPES> values{};
+    for (const auto& stock : stocks) {
+        if (stock.first != ItemType::Nothing) {
+            items |= 1u << static_cast<int>(stock.first);
+            values[static_cast<int>(stock.first)] = stock.second;
+        }
+    }
+
+    // Most unlocks follow a refused trade or a read, the published line then stays shared in the readers' caches
+    bool changed = money != snapshotFunds.load(std::memory_order_relaxed) || items != snapshotItems.load(std::memory_order_relaxed);
+    for (int item = 0; item < NB_ITEM_TYPES && !changed; ++item) {
+        changed = values[item] != snapshotStocks[item].load(std::memory_order_relaxed);
+    }
+    if (!changed) {
+        return;
+    }
+
+    uint32_t sequence = snapshotSequence.load(std::memory_order_relaxed);
+    snapshotSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    snapshotFunds.store(money, std::memory_order_relaxed);
+    snapshotItems.store(items, std::memory_order_relaxed);
+    for (int item = 0; item < NB_ITEM_TYPES; ++item) {
+        snapshotStocks[item].store(values[item], std::memory_order_relaxed);
+    }
+    snapshotSequence.store(sequence + 2, std::memory_order_release);
+}
+
 ItemType Seller::chooseRandomItem(std::map<ItemType, int> &itemsForSale) {
     if (!itemsForSale.size()) {
         return ItemType::Nothing;
     }
     std::vector<std::pair<ItemType, int> > out;
     std::sample(itemsForSale.begin(), itemsForSale.end(), std::back_inserter(out),
-            1, std::mt19937{std::random_device{}()});
+            1, Replay::random());
     return out.front().first;
 }
 
@@ -34,6 +118,10 @@ int getCostPerUnit(ItemType item) {
     }
 }
 
+bool isPatient(ItemType item) {
+    return item == ItemType::PatientSick || item == ItemType::PatientHealed;
+}
+
 QString getItemName(ItemType item) {
     switch (item) {
         case ItemType::Syringe : return "Syringe";
@@ -70,6 +158,99 @@ int getEmployeeSalary(EmployeeType employee) {
     }
 }
 
+int Seller::sendBlocking(ItemType what, int qty, int bill, int timeoutSeconds) {
+    return send(what, qty, bill);
+}
+
+int Seller::getAdmissionCapacity(ItemType what) {
+    return 0;
+}
+
 void Seller::setFinished() {
     finished = true;
 }
+
+void Seller::saveState(CheckpointRecord& record, CheckpointWriter& writer) {
+    record.uniqueId = uniqueId;
+    record.money = money;
+    for (int item = 0; item < NB_ITEM_TYPES; ++item) {
+        auto stock = stocks.find(static_cast<ItemType>(item));
+        record.stocks[item] = stock != stocks.end() ? stock->second : CHECKPOINT_NO_STOCK;
+    }
+    record.tradesAccepted = getTradesAccepted();
+    record.tradesRefused = getTradesRefused();
+    record.tradesCrossRegion = getTradesCrossRegion();
+}
+
+void Seller::restoreState(const CheckpointRecord& record, const CheckpointReader& checkpoint) {
+    money = record.money;
+    stocks.clear();
+    for (int item = 0; item < NB_ITEM_TYPES; ++item) {
+        if (record.stocks[item] != CHECKPOINT_NO_STOCK) {
+            stocks[static_cast<ItemType>(item)] = record.stocks[item];
+        }
+    }
+    for (ItemType item : {ItemType::PatientSick, ItemType::PatientHealed}) {
+        auto stock = stocks.find(item);
+        getPatientIds(item)->assign(stock != stocks.end() ? std::max(stock->second, 0) : 0, PatientTracker::UNTRACKED);
+    }
+    tradesAccepted.store(record.tradesAccepted, std::memory_order_relaxed);
+    tradesRefused.store(record.tradesRefused, std::memory_order_relaxed);
+    tradesCrossRegion.store(record.tradesCrossRegion, std::memory_order_relaxed);
+    publishSnapshot();
+}
+
+bool Seller::isFinished() {
+    ReplayTurn step(ReplayOp::Step);
+    return finished;
+}
+
+std::deque<PatientId>* Seller::getPatientIds(ItemType item) {
+    switch (item) {
+        case ItemType::PatientSick : return &sickPatientIds;
+        case ItemType::PatientHealed : return &healedPatientIds;
+        default : return nullptr;
+    }
+}
+
+void Seller::givePatients(ItemType item, int qty) {
+    std::deque<PatientId>* ids = getPatientIds(item);
+    if (!ids) {
+        return;
+    }
+    std::deque<PatientId>& handoff = PatientTracker::handoff();
+    for (int i = 0; i < qty; ++i) {
+        if (ids->empty()) {
+            handoff.push_back(PatientTracker::UNTRACKED);
+        } else {
+            handoff.push_back(ids->front());
+            ids->pop_front();
+        }
+    }
+}
+
+void Seller::receivePatients(ItemType item, int qty, PatientStage stage) {
+    std::deque<PatientId>* ids = getPatientIds(item);
+    if (!ids) {
+        return;
+    }
+    std::deque<PatientId>& handoff = PatientTracker::handoff();
+    for (int i = 0; i < qty; ++i) {
+        PatientId id = PatientTracker::UNTRACKED;
+        if (!handoff.empty()) {
+            id = handoff.front();
+            handoff.pop_front();
+        }
+        PatientTracker::stamp(id, stage);
+        ids->push_back(id);
+    }
+}
+
+void Seller::restorePatients(ItemType item) {
+    std::deque<PatientId>* ids = getPatientIds(item);
+    std::deque<PatientId>& handoff = PatientTracker::handoff();
+    if (ids) {
+        ids->insert(ids->begin(), handoff.begin(), handoff.end());
+    }
+    handoff.clear();
+}
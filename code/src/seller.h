@@ -3,29 +3,77 @@
 
 #include <QString>
 #include <QStringBuilder>
+#include <array>
 #include <map>
 #include <vector>
+#include <deque>
+#include <atomic>
 #include "costs.h"
+#include "patientTracker.h"
+#include "latencyHistogram.h"
+#include "replay.h"
 
 enum class ItemType {
     PatientSick, PatientHealed, Syringe, Pill, Scalpel, Thermometer, Stethoscope, Nothing
 };
 
+#define NB_ITEM_TYPES 7 // Nombre d'items échangeables, ItemType::Nothing exclu
+
+#define ANY_REGION -1   // Choix d'un vendeur sans préférence de région
+
 int getCostPerUnit(ItemType item);
 QString getItemName(ItemType item);
+bool isPatient(ItemType item);
 
 enum class EmployeeType {Supplier, Nurse, Doctor};
 
 EmployeeType getEmployeeThatProduces(ItemType item);
 int getEmployeeSalary(EmployeeType employee);
 
+struct CheckpointRecord;
+class CheckpointWriter;
+class CheckpointReader;
+
+/**
+ * @brief The SellerState struct
+ * Argent et stocks d'un vendeur au même instant
+ */
+struct SellerState {
+    int funds;
+    std::map<ItemType, int> stocks;
+};
+
+#define SELLER_SNAPSHOT_ALIGNMENT 64    // L'instantané lu par les autres threads occupe sa propre ligne de cache
+
+/**
+ * @brief The SellerSnapshot struct
+ * Argent et stocks d'un vendeur tels qu'à la dernière libération de son mutex, de taille fixe : le lire n'alloue rien
+ */
+struct SellerSnapshot {
+    int funds = 0;
+    uint32_t items = 0;                         // Items présents dans les stocks, un bit par ItemType
+    std::array<int, NB_ITEM_TYPES> stocks{};    // 0 pour un item absent
+
+    bool has(ItemType item) const { return item != ItemType::Nothing && (items >> static_cast<int>(item)) & 1; }
+
+    int getStock(ItemType item) const { return has(item) ? stocks[static_cast<int>(item)] : 0; }
+
+    /**
+     * @brief toMap
+     * @return Les stocks présents, sous la forme de Seller::stocks
+     */
+    std::map<ItemType, int> toMap() const;
+};
+
 class Seller {
 public:
     /**
      * @brief Seller
      * @param money money money !
      */
-    Seller(int money, int uniqueId) : money(money), uniqueId(uniqueId) {}
+    Seller(int money, int uniqueId) : money(money), uniqueId(uniqueId), finished(false), snapshotFunds(money) {}
+
+    virtual ~Seller() = default;
 
     /**
      * @brief getItemsForSale
@@ -33,6 +81,43 @@ public:
      */
     virtual std::map<ItemType, int> getItemsForSale() = 0;
 
+    /**
+     * @brief getState
+     * @return Une copie de l'argent et des stocks, pouvant être lue depuis un autre thread que celui du vendeur
+     */
+    virtual SellerState getState() { return {money, stocks}; }
+
+    /**
+     * @brief getSnapshot
+     * @return L'argent et les stocks publiés par le vendeur, cohérents entre eux, lus sans verrou ni allocation
+     * Lisible depuis n'importe quel thread. Le lecteur ne retarde jamais le vendeur : il recommence sa lecture
+     * si une publication a eu lieu pendant celle-ci (seqlock).
+     */
+    SellerSnapshot getSnapshot() const;
+
+    /**
+     * @brief saveState
+     * @param record L'enregistrement du vendeur dans le point de reprise
+     * @param writer Le point de reprise, pour y ajouter les listes de vendeurs liés
+     * Sauvegarde l'argent, les stocks et les compteurs d'échanges, aucun thread de vendeur ne doit tourner
+     */
+    virtual void saveState(CheckpointRecord& record, CheckpointWriter& writer);
+
+    /**
+     * @brief restoreState
+     * @param record L'enregistrement du vendeur dans le point de reprise
+     * @param checkpoint Le point de reprise, pour retrouver les vendeurs liés
+     * Restaure l'état sauvegardé par saveState, avant le lancement des threads. Les patients restaurés ne sont pas
+     * suivis par PatientTracker, leur arrivée date d'une simulation précédente.
+     */
+    virtual void restoreState(const CheckpointRecord& record, const CheckpointReader& checkpoint);
+
+    /**
+     * @brief getTradingPartners
+     * @return Les vendeurs auxquels ce vendeur achète ou transfère des ressources, aucun par défaut
+     */
+    virtual std::vector<Seller*> getTradingPartners() { return {}; }
+
     /**
      * @brief Fonction permettant de proposer des ressources au vendeur
      * @param what Le type de resource
@@ -42,6 +127,24 @@ public:
      */
     virtual int send(ItemType what, int qty, int bill) = 0;
 
+    /**
+     * @brief Fonction permettant de proposer des ressources au vendeur en attendant qu'il puisse les accepter
+     * @param what Le type de resource
+     * @param qty Nombre de ressources
+     * @param bill Le coût de la transaction
+     * @param timeoutSeconds Temps d'attente maximal en secondes
+     * @return La quantité acceptée, 0 si la transaction n'a pas pu être acceptée à temps
+     * Par défaut le vendeur n'attend pas et se comporte comme send.
+     */
+    virtual int sendBlocking(ItemType what, int qty, int bill, int timeoutSeconds);
+
+    /**
+     * @brief getAdmissionCapacity
+     * @param what Le type de resource
+     * @return La quantité de ressources que le vendeur annonce pouvoir accepter immédiatement, 0 s'il n'annonce rien
+     */
+    virtual int getAdmissionCapacity(ItemType what);
+
     /**
      * @brief Fonction permettant d'acheter des ressources au vendeur
      * @param what Le type de resource à acheter
@@ -55,7 +158,17 @@ public:
      * @param sellers
      * @return Returns a random seller from the sellers vector
      */
-    static Seller* chooseRandomSeller(std::vector<Seller*>& sellers);
+    static Seller* chooseRandomSeller(const std::vector<Seller*>& sellers);
+
+    /**
+     * @brief chooseRandomSellerWith
+     * @param sellers
+     * @param item The item wanted
+     * @param qty The quantity wanted
+     * @param region The buyer's region, its sellers are chosen first and the others only when none of them can serve
+     * @return Returns a random seller advertising at least qty units of item, nullptr if there is none
+     */
+    static Seller* chooseRandomSellerWith(const std::vector<Seller*>& sellers, ItemType item, int qty, int region = ANY_REGION);
 
     /**
      * @brief getRandomItemFromStock
@@ -67,7 +180,7 @@ public:
         }
 
         auto it = stocks.begin();
-        std::advance(it, rand() % stocks.size());
+        std::advance(it, Replay::random()() % stocks.size());
 
         return it->first;
     }
@@ -83,13 +196,103 @@ public:
 
     int getUniqueId() { return uniqueId; }
 
+    /**
+     * @brief getRegion
+     * @return La région du vendeur, ses achats restent dans sa région tant qu'elle peut les servir
+     */
+    int getRegion() const { return region; }
+
+    /**
+     * @brief setRegion
+     * Doit être appelée avant le lancement des threads
+     */
+    void setRegion(int region) { this->region = region; }
+
+    /**
+     * @brief getLatencies
+     * @return Les histogrammes de latence des opérations de ce vendeur
+     */
+    const LatencyRecorder& getLatencies() const { return latencies; }
+
+    /**
+     * @brief getTradesAccepted
+     * @return Le nombre de ventes et d'admissions acceptées par ce vendeur
+     */
+    uint64_t getTradesAccepted() const { return tradesAccepted.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief getTradesRefused
+     * @return Le nombre de ventes et d'admissions refusées par ce vendeur
+     */
+    uint64_t getTradesRefused() const { return tradesRefused.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief getTradesCrossRegion
+     * @return Le nombre d'achats et de transferts de ce vendeur servis par un vendeur d'une autre région
+     */
+    uint64_t getTradesCrossRegion() const { return tradesCrossRegion.load(std::memory_order_relaxed); }
+
     /**
      * @brief setFinished
      * Indicates that the program has finished and that the seller should stop
      */
-    void setFinished();
+    virtual void setFinished();
 
 protected:
+    /**
+     * @brief isFinished
+     * @return true si le vendeur doit s'arrêter, la lecture prend son tour dans le journal de rejeu
+     */
+    bool isFinished();
+
+    /**
+     * @brief getPatientIds
+     * @param item Le type de patient
+     * @return La file des identifiants des patients de ce type dans les stocks, nullptr si l'item n'est pas un patient
+     */
+    std::deque<PatientId>* getPatientIds(ItemType item);
+
+    /**
+     * @brief givePatients
+     * Déplace les qty premiers patients de la file vers le tampon d'échange du thread (sous le mutex du vendeur)
+     */
+    void givePatients(ItemType item, int qty);
+
+    /**
+     * @brief receivePatients
+     * Reprend qty patients du tampon d'échange du thread à la fin de la file et date l'étape atteinte (sous le mutex de l'acheteur)
+     */
+    void receivePatients(ItemType item, int qty, PatientStage stage);
+
+    /**
+     * @brief restorePatients
+     * Remet en tête de file les patients restés dans le tampon d'échange, lorsqu'une offre n'a été acceptée qu'en partie
+     */
+    void restorePatients(ItemType item);
+
+    /**
+     * @brief countTrade
+     * @param accepted true si l'échange proposé à ce vendeur a été accepté
+     */
+    void countTrade(bool accepted) { (accepted ? tradesAccepted : tradesRefused).fetch_add(1, std::memory_order_relaxed); }
+
+    /**
+     * @brief countCrossRegion
+     * @param seller Le vendeur qui vient de servir un achat ou un transfert de ce vendeur, compté s'il est d'une autre région
+     */
+    void countCrossRegion(Seller* seller) {
+        if (seller->region != region) {
+            tradesCrossRegion.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief publishSnapshot
+     * Publie l'argent et les stocks courants pour getSnapshot. Un seul thread publie à la fois : celui qui tient
+     * le mutex du vendeur, ou le thread du vendeur pour ceux qui n'ont pas de mutex.
+     */
+    void publishSnapshot();
+
     /**
      * @brief stocks : Type, Quantité
      */
@@ -97,7 +300,23 @@ protected:
     int money;
     int uniqueId;
     bool finished;
+    int region = 0;
+
+    std::deque<PatientId> sickPatientIds;   // Identifiants des patients malades en stock, dans l'ordre d'arrivée
+    std::deque<PatientId> healedPatientIds; // Identifiants des patients soignés en stock, dans l'ordre d'arrivée
+
+    LatencyRecorder latencies; // Latence de request, send, des achats et de l'attente du mutex
+
+    std::atomic<uint64_t> tradesAccepted{0};
+    std::atomic<uint64_t> tradesRefused{0};
+    std::atomic<uint64_t> tradesCrossRegion{0};
 
+private:
+    // Instantané publié par publishSnapshot, impair pendant une publication
+    alignas(SELLER_SNAPSHOT_ALIGNMENT) std::atomic<uint32_t> snapshotSequence{0};
+    std::atomic<int> snapshotFunds{0};
+    std::atomic<uint32_t> snapshotItems{0};
+    std::array<std::atomic<int>, NB_ITEM_TYPES> snapshotStocks{};
 };
 
 #endif // SELLER_H
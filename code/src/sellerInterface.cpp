@@ -20,7 +20,14 @@ void SellerInterface::simulateWork() {
 }
 
 void SellerInterface::updateStock() {
-    interface->updateStock(uniqueId, &stocks);
+    // The display reads the map later from its own thread, it never sees the seller's map being rebalanced
+    SellerSnapshot snapshot = getSnapshot();
+    for (int item = 0; item < NB_ITEM_TYPES; ++item) {
+        if (snapshot.has(static_cast<ItemType>(item))) {
+            interfaceStocks[static_cast<ItemType>(item)] = snapshot.stocks[item];
+        }
+    }
+    interface->updateStock(uniqueId, &interfaceStocks);
 }
 
 void SellerInterface::updateMoney() {
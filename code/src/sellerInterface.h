@@ -64,6 +64,8 @@ protected:
 private:
     static IWindowInterface* interface; // Pointeur statique vers l'interface utilisateur pour les logs et mises à jour visuelles
 
+    std::map<ItemType, int> interfaceStocks; // Copie des stocks lue par l'interface, remplie depuis l'instantané du vendeur
+
 };
 
 #endif // SELLERINTERFACE_H
\ No newline at end of file
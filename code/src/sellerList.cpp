@@ -0,0 +1,167 @@
+#include "sellerList.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+#define RCU_RECORD_ALIGNMENT 64     // Un bloc de lecteur par ligne de cache, ouvrir une section n'invalide pas celle des autres
+
+namespace {
+
+const uint64_t INACTIVE = std::numeric_limits<uint64_t>::max();
+
+}
+
+struct alignas(RCU_RECORD_ALIGNMENT) ReaderRecord {
+    std::atomic<uint64_t> epoch{INACTIVE};  // Époque lue à l'ouverture de la section externe, INACTIVE hors section
+    std::atomic<bool> owned{true};          // Un thread vivant utilise le bloc
+    int depth = 0;                          // Accédé uniquement par le thread propriétaire
+    ReaderRecord* next = nullptr;           // Immuable une fois le bloc enregistré
+};
+
+namespace {
+
+std::atomic<uint64_t> globalEpoch{0};
+std::atomic<ReaderRecord*> records{nullptr};    // Les blocs ne sont jamais libérés, ceux des threads terminés sont réutilisés
+
+struct RetiredList {
+    const std::vector<Seller*>* list;
+    uint64_t epoch;                             // Époque avant l'échange, les sections ouvertes depuis ne voient plus la liste
+};
+
+PcoMutex retiredMutex;                          // Protège uniquement les listes en attente de libération
+std::vector<RetiredList> retired;
+
+ReaderRecord* acquireRecord() {
+    // Registering is a lock-free push, so even a reader's first section never waits for a writer
+    for (ReaderRecord* record = records.load(std::memory_order_acquire); record; record = record->next) {
+        bool owned = false;
+        if (!record->owned.load(std::memory_order_relaxed) &&
+            record->owned.compare_exchange_strong(owned, true, std::memory_order_acquire)) {
+            return record;
+        }
+    }
+    ReaderRecord* record = new ReaderRecord();
+    record->next = records.load(std::memory_order_relaxed);
+    while (!records.compare_exchange_weak(record->next, record, std::memory_order_release, std::memory_order_relaxed)) {}
+    return record;
+}
+
+struct RecordOwner {
+    ReaderRecord* record = acquireRecord();
+    ~RecordOwner() { record->owned.store(false, std::memory_order_release); }
+};
+
+ReaderRecord* threadRecord() {
+    thread_local RecordOwner owner;
+    return owner.record;
+}
+
+uint64_t oldestActiveEpoch() {
+    uint64_t oldest = INACTIVE;
+    for (ReaderRecord* record = records.load(std::memory_order_acquire); record; record = record->next) {
+        oldest = std::min(oldest, record->epoch.load(std::memory_order_seq_cst));
+    }
+    return oldest;
+}
+
+// retiredMutex must be held
+void reclaim() {
+    uint64_t oldest = oldestActiveEpoch();
+    auto end = std::remove_if(retired.begin(), retired.end(), [oldest](const RetiredList& list) {
+        if (list.epoch >= oldest) {
+            return false;
+        }
+        delete list.list;
+        return true;
+    });
+    retired.erase(end, retired.end());
+}
+
+void retire(const std::vector<Seller*>* list) {
+    retiredMutex.lock();
+    // The list was unpublished before the epoch moves on, a section that reads the new epoch reads the new list
+    retired.push_back({list, globalEpoch.fetch_add(1, std::memory_order_seq_cst)});
+    reclaim();
+    retiredMutex.unlock();
+}
+
+}
+
+RcuReadScope::RcuReadScope() : record(threadRecord()) {
+    if (record->depth++ == 0) {
+        // Published before the list pointer is loaded, a writer that unpublishes the list afterwards sees the section
+        record->epoch.store(globalEpoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    }
+}
+
+RcuReadScope::~RcuReadScope() {
+    if (--record->depth == 0) {
+        record->epoch.store(INACTIVE, std::memory_order_release);
+    }
+}
+
+SellerList::SellerList() : current(new std::vector<Seller*>()) {}
+
+SellerList::SellerList(std::vector<Seller*> sellers) : current(new std::vector<Seller*>(std::move(sellers))) {}
+
+SellerList::~SellerList() {
+    // No reader is left, the lists retired earlier are freed once the other lists' readers are done with theirs
+    delete current.load(std::memory_order_relaxed);
+    retiredMutex.lock();
+    reclaim();
+    retiredMutex.unlock();
+}
+
+SellerList& SellerList::operator=(std::vector<Seller*> sellers) {
+    update([&sellers](std::vector<Seller*>& list) {
+        list = std::move(sellers);
+        return true;
+    });
+    return *this;
+}
+
+std::vector<Seller*> SellerList::copy() const {
+    RcuReadScope scope;
+    return read();
+}
+
+size_t SellerList::size() const {
+    RcuReadScope scope;
+    return read().size();
+}
+
+bool SellerList::add(Seller* seller) {
+    return update([seller](std::vector<Seller*>& list) {
+        if (std::find(list.begin(), list.end(), seller) != list.end()) {
+            return false;
+        }
+        list.push_back(seller);
+        return true;
+    });
+}
+
+bool SellerList::remove(Seller* seller) {
+    return update([seller](std::vector<Seller*>& list) {
+        auto found = std::find(list.begin(), list.end(), seller);
+        if (found == list.end()) {
+            return false;
+        }
+        list.erase(found);
+        return true;
+    });
+}
+
+bool SellerList::update(const std::function<bool(std::vector<Seller*>&)>& change) {
+    writerMutex.lock();
+    auto* next = new std::vector<Seller*>(*current.load(std::memory_order_relaxed));
+    if (!change(*next)) {
+        writerMutex.unlock();
+        delete next;
+        return false;
+    }
+    const std::vector<Seller*>* previous = current.exchange(next, std::memory_order_seq_cst);
+    writerMutex.unlock();
+
+    retire(previous);
+    return true;
+}
@@ -0,0 +1,94 @@
+#ifndef SELLERLIST_H
+#define SELLERLIST_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include <pcosynchro/pcomutex.h>
+
+class Seller;
+struct ReaderRecord;
+
+/**
+ * @brief The RcuReadScope class
+ * Section de lecture des listes de vendeurs : tant qu'elle est ouverte, les listes lues par le thread ne sont pas libérées.
+ * Ouvrir et fermer une section sont deux écritures dans un bloc propre au thread, sans verrou ni écriture partagée.
+ * Les sections peuvent être imbriquées, seule la plus externe compte. Un thread ne doit pas y attendre longtemps :
+ * tant qu'elle est ouverte, les listes remplacées depuis son ouverture restent en mémoire.
+ */
+class RcuReadScope {
+public:
+    RcuReadScope();
+    ~RcuReadScope();
+
+    RcuReadScope(const RcuReadScope&) = delete;
+    RcuReadScope& operator=(const RcuReadScope&) = delete;
+
+private:
+    ReaderRecord* record;     // Bloc du thread, enregistré à sa première section
+};
+
+/**
+ * @brief The SellerList class
+ * Liste de partenaires commerciaux modifiable pendant la simulation (read-copy-update).
+ * Les lecteurs suivent un pointeur vers une liste immuable, sans verrou. Un changement copie la liste, modifie la copie
+ * et la publie d'un seul échange de pointeur ; l'ancienne liste est libérée lorsque plus aucune section de lecture
+ * ouverte avant l'échange n'est en cours. Les écrivains sont sérialisés entre eux par un mutex que les lecteurs ne prennent jamais.
+ * Seules les listes sont récupérées : un vendeur retiré reste valide jusqu'à la destruction du monde.
+ */
+class SellerList {
+public:
+    SellerList();
+    SellerList(std::vector<Seller*> sellers);
+    ~SellerList();
+
+    SellerList(const SellerList&) = delete;
+    SellerList& operator=(const SellerList&) = delete;
+
+    /**
+     * @brief operator=
+     * Remplace toute la liste, par exemple lors de la mise en place ou de la reprise d'un point de sauvegarde
+     */
+    SellerList& operator=(std::vector<Seller*> sellers);
+
+    /**
+     * @brief read
+     * @return La liste courante, valide jusqu'à la fermeture de la section de lecture qui doit être ouverte
+     */
+    const std::vector<Seller*>& read() const { return *current.load(std::memory_order_seq_cst); }
+
+    /**
+     * @brief copy
+     * @return Une copie de la liste courante, lue dans sa propre section de lecture
+     */
+    std::vector<Seller*> copy() const;
+
+    size_t size() const;
+
+    bool empty() const { return size() == 0; }
+
+    /**
+     * @brief add
+     * @return false si le vendeur était déjà dans la liste
+     */
+    bool add(Seller* seller);
+
+    /**
+     * @brief remove
+     * @return false si le vendeur n'était pas dans la liste
+     */
+    bool remove(Seller* seller);
+
+private:
+    /**
+     * @brief update
+     * Publie une copie de la liste modifiée par change, sauf s'il rend false, puis retire l'ancienne
+     */
+    bool update(const std::function<bool(std::vector<Seller*>&)>& change);
+
+    std::atomic<const std::vector<Seller*>*> current;
+    PcoMutex writerMutex;   // Sérialise les écrivains, pour qu'aucun changement concurrent ne soit perdu
+};
+
+#endif // SELLERLIST_H
@@ -1,7 +1,12 @@
 #include "sellerMutex.h"
 #include <iostream>
+#include <algorithm>
+#include "trace.h"
+#include "conservationAuditor.h"
+#include "transactionLog.h"
 
-SellerMutex::SellerMutex(int money, int uniqueId) : SellerInterface(money, uniqueId), mutex(), mutexInterface() {}
+SellerMutex::SellerMutex(int money, int uniqueId)
+    : SellerInterface(money, uniqueId), mutex(uniqueId, LockRole::Resources), mutexInterface(uniqueId, LockRole::Interface) {}
 
 void SellerMutex::updateInterface() {
     mutexInterface.lock();
@@ -34,16 +39,38 @@ void SellerMutex::updateMoney() {
     mutexInterface.unlock();
 }
 
+/**
+ * @brief Étape atteinte par un patient acheté : les cliniques achètent des malades, les hôpitaux des soignés
+ */
+static PatientStage getPurchaseStage(ItemType item) {
+    return item == ItemType::PatientSick ? PatientStage::InClinic : PatientStage::Resting;
+}
+
 bool SellerMutex::buyFromSeller(Seller* seller, ItemType item, int qty, int costExpected) {
+    ScopedLatency latency(latencies, SellerOperation::Buy);
+    TraceSpan span("buyFromSeller", uniqueId);
 
-    int bill = seller->request(item, qty);
+    PatientTracker::handoff().clear();
+
+    int bill;
+    {
+        TraceFlow flow(uniqueId);
+        bill = seller->request(item, qty);
+    }
 
     if(bill > 0) {
+        countCrossRegion(seller);
         if(bill > costExpected) { // The bill can be lower given personnel costs and other such things
             std::cerr << "Error: cost of resource is not correct" << std::endl;
         }
         lockMutex();
         stocks[item] += qty;
+        if (isPatient(item)) {
+            ConservationAuditor::record(AuditQuantity::Patients, qty);
+        }
+        receivePatients(item, qty, getPurchaseStage(item));
+        // The order was paid before the request, it is only logged once it cannot be refunded
+        TransactionLog::append(TransactionKind::Purchase, uniqueId, static_cast<int>(item), qty, -costExpected, money);
         unlockMutex();
 
         updateWithMessage("Bought " + QString::number(qty) + " " + getItemName(item) + " from " + QString::number(seller->getUniqueId()));
@@ -52,6 +79,7 @@ bool SellerMutex::buyFromSeller(Seller* seller, ItemType item, int qty, int cost
     } else {
         lockMutex();
         money += costExpected;
+        ConservationAuditor::record(AuditQuantity::Funds, costExpected);
         unlockMutex();
 
         interfaceMessage("Not enough " + getItemName(item) + " available at " + QString::number(seller->getUniqueId()));
@@ -60,6 +88,13 @@ bool SellerMutex::buyFromSeller(Seller* seller, ItemType item, int qty, int cost
     }
 }
 
+SellerState SellerMutex::getState() {
+    lockMutex();
+    SellerState state{money, stocks};
+    unlockMutex();
+    return state;
+}
+
 int SellerMutex::buyFromSellers(std::vector<Seller*> sellers, ItemType item, int maxQty, int costPerOrder, int numberPerOrder) {
     int qty = 0;
 
@@ -85,6 +120,7 @@ int SellerMutex::buyFromSellers(std::vector<Seller*> sellers, ItemType item, int
                 interfaceMessage("Not enough money to buy " + getItemName(item) + " from " + QString::number(seller->getUniqueId()));
             } else {
                 money -= costPerOrder;
+                ConservationAuditor::record(AuditQuantity::Funds, -costPerOrder);
                 unlockMutex();
 
                 if(buyFromSeller(seller, item, numberPerOrder, costPerOrder)) {
@@ -99,3 +135,127 @@ int SellerMutex::buyFromSellers(std::vector<Seller*> sellers, ItemType item, int
 
     return qty;
 }
+
+bool SellerMutex::canSell(ItemType item, int qty) {
+    return false;
+}
+
+int SellerMutex::sell(ItemType item, int qty) {
+    return 0;
+}
+
+bool SellerMutex::buyBundleFromSellers(std::vector<BundleItem> bundle) {
+    ScopedLatency latency(latencies, SellerOperation::Bundle);
+    TraceSpan span("buyBundleFromSellers", uniqueId);
+
+    // Merge the lines asking the same item from the same seller, so each check sees the full quantity
+    std::vector<BundleItem> lines;
+    for (const BundleItem& order : bundle) {
+        auto it = std::find_if(lines.begin(), lines.end(), [&order](const BundleItem& line) {
+            return line.seller == order.seller && line.item == order.item;
+        });
+        if (it != lines.end()) {
+            it->qty += order.qty;
+        } else {
+            lines.push_back(order);
+        }
+    }
+
+    PatientTracker::handoff().clear();
+
+    std::vector<SellerMutex*> sellers;
+    int cost = 0;
+    for (const BundleItem& line : lines) {
+        SellerMutex* seller = dynamic_cast<SellerMutex*>(line.seller);
+        if (!seller || line.qty <= 0) {
+            std::cerr << "Error: invalid bundle line" << std::endl;
+            return false;
+        }
+        if (std::find(sellers.begin(), sellers.end(), seller) == sellers.end()) {
+            sellers.push_back(seller);
+        }
+        cost += getCostPerUnit(line.item) * line.qty;
+    }
+
+    if (lines.empty()) {
+        return false;
+    }
+
+    lockMutex();
+    if (money < cost) {
+        unlockMutex();
+        interfaceMessage("Not enough money to buy a bundle of " + QString::number(lines.size()) + " items");
+        return false;
+    }
+    money -= cost;
+    ConservationAuditor::record(AuditQuantity::Funds, -cost);
+    unlockMutex();
+
+    // Global lock order : every bundle locks its sellers by increasing uniqueId
+    std::sort(sellers.begin(), sellers.end(), [](SellerMutex* a, SellerMutex* b) {
+        return a->getUniqueId() < b->getUniqueId();
+    });
+
+    for (SellerMutex* seller : sellers) {
+        seller->lockMutex();
+    }
+
+    bool available = true;
+    for (const BundleItem& line : lines) {
+        SellerMutex* seller = static_cast<SellerMutex*>(line.seller);
+        if (!seller->canSell(line.item, line.qty)) {
+            seller->countTrade(false);
+            available = false;
+        }
+    }
+
+    int bill = 0;
+    if (available) {
+        for (const BundleItem& line : lines) {
+            countCrossRegion(line.seller);
+            TraceFlow flow(uniqueId);
+            TraceSpan sell("sell", line.seller->getUniqueId());
+            bill += static_cast<SellerMutex*>(line.seller)->sell(line.item, line.qty);
+        }
+    }
+
+    for (auto it = sellers.rbegin(); it != sellers.rend(); ++it) {
+        (*it)->unlockMutex();
+    }
+
+    if (!available) {
+        lockMutex();
+        money += cost;
+        ConservationAuditor::record(AuditQuantity::Funds, cost);
+        unlockMutex();
+
+        interfaceMessage("Bundle of " + QString::number(lines.size()) + " items not available");
+
+        return false;
+    }
+
+    if (bill > cost) {
+        std::cerr << "Error: cost of bundle is not correct" << std::endl;
+    }
+
+    lockMutex();
+    for (const BundleItem& line : lines) {
+        stocks[line.item] += line.qty;
+        if (isPatient(line.item)) {
+            ConservationAuditor::record(AuditQuantity::Patients, line.qty);
+        }
+        receivePatients(line.item, line.qty, getPurchaseStage(line.item));
+        // One record per line, the funds are those left once the whole bundle is paid
+        TransactionLog::append(TransactionKind::Purchase, uniqueId, static_cast<int>(line.item), line.qty,
+                               -getCostPerUnit(line.item) * line.qty, money);
+    }
+    unlockMutex();
+
+    for (SellerMutex* seller : sellers) {
+        seller->updateWithMessage("Sold part of a bundle to " + QString::number(uniqueId));
+    }
+
+    updateWithMessage("Bought a bundle of " + QString::number(lines.size()) + " items");
+
+    return true;
+}
@@ -2,7 +2,17 @@
 #define SELLERMUTEX_H
 
 #include "sellerInterface.h"
-#include <pcosynchro/pcomutex.h>
+#include "instrumentedMutex.h"
+
+/**
+ * @brief The BundleItem struct
+ * One line of a bundle order : qty units of item bought from seller
+ */
+struct BundleItem {
+    Seller* seller;
+    ItemType item;
+    int qty;
+};
 
 // Classe SellerMutex is a subclass of SellerInterface
 
@@ -15,6 +25,12 @@ public:
      */
     SellerMutex(int money, int uniqueId);
 
+    /**
+     * @brief getState
+     * @return A copy of the money and the stocks taken under the mutex
+     */
+    SellerState getState() override;
+
 protected:
 
     /**
@@ -39,15 +55,37 @@ protected:
 
     /**
      * @brief lockMutex
-     * Locks the mutex
+     * Takes a replay turn and locks the mutex, the time spent waiting for a contended mutex is recorded as SellerOperation::LockWait
      */
-    void lockMutex() { mutex.lock(); }
+    void lockMutex() {
+        Replay::enter(ReplayOp::Lock);
+        uint64_t waited = mutex.lock();
+        if (waited > 0) {
+            latencies.record(SellerOperation::LockWait, waited);
+        }
+    }
 
     /**
      * @brief unlockMutex
-     * Unlocks the mutex
+     * Publishes the snapshot of the state, unlocks the mutex and ends the replay turn taken by lockMutex
      */
-    void unlockMutex() { mutex.unlock(); }
+    void unlockMutex() {
+        publishSnapshot();
+        mutex.unlock();
+        Replay::leave();
+    }
+
+    /**
+     * @brief waitMutex
+     * @param condition The condition to wait on
+     * @param timeoutSeconds The maximum time to wait, in seconds
+     * @return false if the wait timed out
+     * Releases the mutex while waiting on the condition, the mutex must be held and is held again on return
+     */
+    bool waitMutex(PcoConditionVariable& condition, int timeoutSeconds) {
+        publishSnapshot();
+        return mutex.wait(condition, timeoutSeconds);
+    }
 
     /**
      * @brief updateStock
@@ -83,9 +121,36 @@ protected:
      */
     int buyFromSellers(std::vector<Seller*> sellers, ItemType item, int maxQty, int costPerOrder = -1, int numberPerOrder = 1);
 
+    /**
+     * @brief buyBundleFromSellers
+     * @param bundle The items to buy, possibly from several sellers
+     * @return true if the whole bundle was bought, false if nothing was bought
+     * Buys every line of the bundle or none of them. The sellers are locked together in the order of their
+     * uniqueId, so two concurrent bundles can never deadlock, and the buyer's own mutex is never held at the same time.
+     */
+    bool buyBundleFromSellers(std::vector<BundleItem> bundle);
+
+    /**
+     * @brief canSell
+     * @param item The item requested
+     * @param qty The quantity requested
+     * @return true if the seller can provide qty units of item right now
+     * The mutex must be held by the caller
+     */
+    virtual bool canSell(ItemType item, int qty);
+
+    /**
+     * @brief sell
+     * @param item The item sold
+     * @param qty The quantity sold
+     * @return The bill of the sale
+     * Takes the items out of the stocks and cashes the bill, canSell must have returned true and the mutex must still be held
+     */
+    virtual int sell(ItemType item, int qty);
+
 private:
-    PcoMutex mutex;                     // Mutex pour la synchronisation des ressources partagées
-    PcoMutex mutexInterface;            // Mutex pour la synchronisation de l'interface utilisateur
+    InstrumentedMutex mutex;            // Mutex pour la synchronisation des ressources partagées
+    InstrumentedMutex mutexInterface;   // Mutex pour la synchronisation de l'interface utilisateur
 };
 
 #endif // SELLERMUTEX_H
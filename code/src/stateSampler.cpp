@@ -0,0 +1,139 @@
+#include "stateSampler.h"
+#include <chrono>
+#include <iostream>
+#include <pcosynchro/pcothread.h>
+
+std::string StateSampler::path;
+int StateSampler::periodMs = SAMPLER_PERIOD_MS;
+
+void StateSampler::configure(const QString& file, int period) {
+    path = file.toStdString();
+    periodMs = period > 0 ? period : SAMPLER_PERIOD_MS;
+}
+
+bool StateSampler::isEnabled() {
+    return !path.empty();
+}
+
+StateSampler::StateSampler(std::vector<Ambulance*> ambulances, std::vector<Supplier*> suppliers,
+                           std::vector<Clinic*> clinics, std::vector<Hospital*> hospitals)
+    : nbSamplesInBlock(0), nbSamples(0), nbBytes(0), file(nullptr), finished(false)
+{
+    for (Ambulance* ambulance : ambulances) {
+        sellers.emplace_back(ambulance, "ambulance");
+    }
+    for (Supplier* supplier : suppliers) {
+        sellers.emplace_back(supplier, "supplier");
+    }
+    for (Clinic* clinic : clinics) {
+        sellers.emplace_back(clinic, "clinic");
+    }
+    for (Hospital* hospital : hospitals) {
+        sellers.emplace_back(hospital, "hospital");
+    }
+    columns.resize(sellers.size() * (NB_ITEM_TYPES + 1));
+}
+
+void StateSampler::setFinished() {
+    finished.store(true, std::memory_order_relaxed);
+}
+
+void StateSampler::write(const std::vector<uint8_t>& bytes) {
+    std::fwrite(bytes.data(), 1, bytes.size(), file);
+    nbBytes += bytes.size();
+}
+
+void StateSampler::writeHeader() {
+    std::vector<uint8_t> header(SampleFormat::MAGIC, SampleFormat::MAGIC + sizeof(SampleFormat::MAGIC));
+    SampleFormat::writeVarint(header, SAMPLE_FORMAT_VERSION);
+    SampleFormat::writeVarint(header, periodMs);
+
+    SampleFormat::writeVarint(header, NB_ITEM_TYPES);
+    for (int item = 0; item < NB_ITEM_TYPES; ++item) {
+        std::string name = getItemName(static_cast<ItemType>(item)).toStdString();
+        SampleFormat::writeVarint(header, name.size());
+        header.insert(header.end(), name.begin(), name.end());
+    }
+
+    SampleFormat::writeVarint(header, sellers.size());
+    for (const auto& seller : sellers) {
+        std::string kind = seller.second;
+        SampleFormat::writeVarint(header, seller.first->getUniqueId());
+        SampleFormat::writeVarint(header, kind.size());
+        header.insert(header.end(), kind.begin(), kind.end());
+    }
+    write(header);
+}
+
+void StateSampler::sample(int64_t timestampMs) {
+    timestamps.append(timestampMs);
+    for (size_t i = 0; i < sellers.size(); ++i) {
+        SellerSnapshot state = sellers[i].first->getSnapshot();
+        SampleFormat::ColumnEncoder* column = &columns[i * (NB_ITEM_TYPES + 1)];
+        column[0].append(state.funds);
+        for (int item = 0; item < NB_ITEM_TYPES; ++item) {
+            column[1 + item].append(state.stocks[item]);
+        }
+    }
+    ++nbSamples;
+    if (++nbSamplesInBlock == SAMPLER_BLOCK_SAMPLES) {
+        flushBlock();
+    }
+}
+
+void StateSampler::flushBlock() {
+    if (nbSamplesInBlock == 0) {
+        return;
+    }
+    std::vector<uint8_t> block;
+    SampleFormat::writeVarint(block, nbSamplesInBlock);
+
+    std::vector<uint8_t> column = timestamps.finish();
+    SampleFormat::writeVarint(block, column.size());
+    block.insert(block.end(), column.begin(), column.end());
+    for (SampleFormat::ColumnEncoder& encoder : columns) {
+        column = encoder.finish();
+        SampleFormat::writeVarint(block, column.size());
+        block.insert(block.end(), column.begin(), column.end());
+    }
+
+    write(block);
+    std::fflush(file);
+    nbSamplesInBlock = 0;
+}
+
+void StateSampler::run() {
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Cannot write the state samples " << path << std::endl;
+        return;
+    }
+    writeHeader();
+
+    auto start = std::chrono::steady_clock::now();
+    auto nextTime = start;
+
+    while (!finished.load(std::memory_order_relaxed)) {
+        auto now = std::chrono::steady_clock::now();
+        if (now < nextTime) {
+            PcoThread::usleep(std::chrono::duration_cast<std::chrono::microseconds>(nextTime - now).count());
+            continue;
+        }
+        sample(std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count());
+        nextTime += std::chrono::milliseconds(periodMs);
+    }
+
+    sample(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+    flushBlock();
+    std::fclose(file);
+    file = nullptr;
+}
+
+QString StateSampler::report() {
+    return QString("State samples : %1 samples of %2 sellers every %3 ms, %4 bytes (%5 bytes per sample)")
+        .arg(static_cast<unsigned long long>(nbSamples))
+        .arg(static_cast<unsigned long long>(sellers.size()))
+        .arg(periodMs)
+        .arg(static_cast<unsigned long long>(nbBytes))
+        .arg(nbSamples ? static_cast<double>(nbBytes) / nbSamples : 0.0, 0, 'f', 1);
+}
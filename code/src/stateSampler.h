@@ -0,0 +1,78 @@
+#ifndef STATESAMPLER_H
+#define STATESAMPLER_H
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+#include <QString>
+
+#include "ambulance.h"
+#include "supplier.h"
+#include "clinic.h"
+#include "hospital.h"
+#include "sampleFormat.h"
+
+#define SAMPLER_PERIOD_MS 100           // Intervalle par défaut entre deux échantillons
+#define SAMPLER_BLOCK_SAMPLES 256       // Échantillons par bloc écrit sur disque
+
+/**
+ * @brief The StateSampler class
+ * Échantillonne à intervalle fixe l'argent et les stocks de chaque vendeur, lus ensemble dans son instantané (getSnapshot),
+ * et les écrit en colonnes compressées (voir sampleFormat.h). Une grandeur qui ne change pas coûte quelques octets
+ * par bloc, quel que soit le nombre d'échantillons du bloc.
+ */
+class StateSampler {
+public:
+    /**
+     * @brief configure
+     * @param path Fichier des échantillons, vide pour ne pas échantillonner
+     * @param periodMs Intervalle entre deux échantillons
+     * Doit être appelée avant la création de Utils.
+     */
+    static void configure(const QString& path, int periodMs);
+
+    static bool isEnabled();
+
+    StateSampler(std::vector<Ambulance*> ambulances, std::vector<Supplier*> suppliers,
+                 std::vector<Clinic*> clinics, std::vector<Hospital*> hospitals);
+
+    /**
+     * @brief run
+     * Échantillonne jusqu'à setFinished(), puis prend un dernier échantillon et ferme le fichier
+     */
+    void run();
+
+    void setFinished();
+
+    /**
+     * @brief report
+     * @return Le nombre d'échantillons et la taille du fichier
+     */
+    QString report();
+
+private:
+    void sample(int64_t timestampMs);
+
+    void write(const std::vector<uint8_t>& bytes);
+
+    void writeHeader();
+
+    void flushBlock();
+
+    std::vector<std::pair<Seller*, const char*>> sellers;   // Vendeur et son type
+    SampleFormat::ColumnEncoder timestamps;
+    std::vector<SampleFormat::ColumnEncoder> columns;       // Par vendeur : argent puis stock de chaque item
+    uint64_t nbSamplesInBlock;
+    uint64_t nbSamples;
+    uint64_t nbBytes;
+    FILE* file;
+
+    std::atomic<bool> finished;
+
+    static std::string path;
+    static int periodMs;
+};
+
+#endif // STATESAMPLER_H
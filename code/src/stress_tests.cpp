@@ -0,0 +1,422 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <pcosynchro/pcothread.h>
+
+#include "supplier.h"
+#include "clinic.h"
+#include "hospital.h"
+#include "sellerMutex.h"
+#include "sellerList.h"
+#include "mpscQueue.h"
+#include "iwindowinterface.h"
+
+#define STRESS_DURATION_MS 300      // Durée de chaque mesure
+#define STRESS_FUND 1000000         // Argent de chaque vendeur, assez pour ne pas limiter la mesure
+#define STRESS_PATIENTS 20000       // Patients malades confiés à l'hôpital qui approvisionne la clinique
+
+/**
+ * @brief The StressInterface class
+ * Interface sans état, partagée sans risque par tous les threads ; le travail simulé cède seulement le processeur
+ */
+class StressInterface : public IWindowInterface {
+public:
+    void consoleAppendText(unsigned int consoleId, QString text) override {}
+    void updateFund(unsigned int id, unsigned new_fund) override {}
+    void updateStock(unsigned int id, std::map<ItemType, int>* stocks) override {}
+    void setLink(int from, int to) override {}
+    void setUtils(Utils* utils) override {}
+    void simulateWork() override { std::this_thread::yield(); }
+};
+
+/**
+ * @brief The BuyerTotals struct
+ * Ce que les acheteurs d'une mesure ont demandé, obtenu et payé
+ */
+struct BuyerTotals {
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> accepted{0};
+    std::atomic<int64_t> paid{0};
+};
+
+void buyRepeatedly(Seller& seller, std::vector<ItemType> items, std::atomic<bool>& stop, BuyerTotals& totals) {
+    uint64_t requests = 0;
+    uint64_t accepted = 0;
+    int64_t paid = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        int bill = seller.request(items[requests % items.size()], 1);
+        ++requests;
+        if (bill > 0) {
+            ++accepted;
+            paid += bill;
+        }
+    }
+    totals.requests += requests;
+    totals.accepted += accepted;
+    totals.paid += paid;
+}
+
+/**
+ * @brief measureBuyers
+ * Lance nbBuyers acheteurs sur le vendeur pendant STRESS_DURATION_MS, les routines des vendeurs doivent déjà tourner
+ * @return La durée effective de la mesure en secondes
+ */
+double measureBuyers(Seller& seller, std::vector<ItemType> items, int nbBuyers, BuyerTotals& totals) {
+    std::atomic<bool> stop(false);
+    std::vector<std::unique_ptr<PcoThread>> buyers;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < nbBuyers; ++i) {
+        buyers.emplace_back(std::make_unique<PcoThread>(buyRepeatedly, std::ref(seller), items, std::ref(stop), std::ref(totals)));
+    }
+    PcoThread::usleep(STRESS_DURATION_MS * 1000);
+    stop = true;
+    for (auto& buyer : buyers) {
+        buyer->join();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int getTotalStock(Seller& seller, ItemType item) {
+    SellerState state = seller.getState();
+    auto stock = state.stocks.find(item);
+    return stock != state.stocks.end() ? stock->second : 0;
+}
+
+/**
+ * @brief The ExchangeSeller class
+ * Vendeur qui échange sans cesse son argent contre du stock sous son mutex, la somme des deux ne change jamais
+ */
+class ExchangeSeller : public SellerMutex {
+public:
+    ExchangeSeller() : SellerMutex(STRESS_FUND, 0) {
+        lockMutex();
+        stocks[ItemType::Scalpel] = 0;
+        unlockMutex();
+    }
+
+    std::map<ItemType, int> getItemsForSale() override { return getSnapshot().toMap(); }
+    int send(ItemType what, int qty, int bill) override { return 0; }
+    int request(ItemType what, int qty) override { return 0; }
+
+    void exchange(int qty) {
+        lockMutex();
+        money -= qty;
+        stocks[ItemType::Scalpel] += qty;
+        unlockMutex();
+    }
+};
+
+/**
+ * @brief The BundleBuyer class
+ * Fournisseur dont le test fixe le stock, et qui achète des lots
+ */
+class BundleBuyer : public Supplier {
+public:
+    using Supplier::Supplier;
+    using SellerMutex::buyBundleFromSellers;
+
+    void setStock(ItemType item, int qty) {
+        lockMutex();
+        stocks[item] = qty;
+        unlockMutex();
+    }
+};
+
+class SellerStressTest : public ::testing::TestWithParam<int> {
+protected:
+    void SetUp() override {
+        SellerInterface::setInterface(&interface);
+    }
+
+    StressInterface interface;
+};
+
+TEST_P(SellerStressTest, TestSupplier) {
+    const int nbBuyers = GetParam();
+    MedicalDeviceSupplier supplier(0, STRESS_FUND);
+    std::vector<ItemType> items = supplier.getResourcesSupplied();
+
+    PcoThread production(&Supplier::run, &supplier);
+    BuyerTotals totals;
+    double seconds = measureBuyers(supplier, items, nbBuyers, totals);
+    supplier.setFinished();
+    production.join();
+
+    // Every unit produced was paid for, and is either sold or still in stock
+    int produced = supplier.getAmountPaidToWorkers() / getEmployeeSalary(EmployeeType::Supplier);
+    int inStock = 0;
+    for (ItemType item : items) {
+        inStock += getTotalStock(supplier, item);
+    }
+    EXPECT_EQ(supplier.getFund() + supplier.getAmountPaidToWorkers(), STRESS_FUND + totals.paid);
+    EXPECT_EQ(uint64_t(produced), totals.accepted + inStock);
+    EXPECT_EQ(supplier.getTradesAccepted(), totals.accepted);
+    EXPECT_EQ(supplier.getTradesAccepted() + supplier.getTradesRefused(), totals.requests);
+
+    std::printf("[   STRESS ] Supplier, %d buyer(s) : %.0f requests/s, %.1f%% accepted, %.0f units produced/s\n", nbBuyers,
+                totals.requests / seconds, totals.requests ? 100.0 * totals.accepted / totals.requests : 0.0, produced / seconds);
+}
+
+TEST_P(SellerStressTest, TestClinic) {
+    const int nbBuyers = GetParam();
+    const int bill = getCostPerUnit(ItemType::PatientSick);
+
+    Pulmonology clinic(0, STRESS_FUND);
+    Pharmacy pharmacy(1, STRESS_FUND);
+    MedicalDeviceSupplier devices(2, STRESS_FUND);
+    Hospital hospital(3, STRESS_FUND, STRESS_PATIENTS);
+    ASSERT_EQ(hospital.send(ItemType::PatientSick, STRESS_PATIENTS, STRESS_PATIENTS * bill), STRESS_PATIENTS);
+    clinic.setHospitalsAndSuppliers({&hospital}, {&pharmacy, &devices});
+
+    PcoThread pharmacyProduction(&Supplier::run, &pharmacy);
+    PcoThread devicesProduction(&Supplier::run, &devices);
+    PcoThread treatment(&Clinic::run, &clinic);
+    BuyerTotals totals;
+    double seconds = measureBuyers(clinic, {ItemType::PatientHealed}, nbBuyers, totals);
+    clinic.setFinished();
+    pharmacy.setFinished();
+    devices.setFinished();
+    treatment.join();
+    pharmacyProduction.join();
+    devicesProduction.join();
+
+    // The patients' bill went to the test, acting as the ambulance, and the buyers' payments came from outside
+    int64_t endFund = 0;
+    for (Seller* seller : std::vector<Seller*>{&clinic, &pharmacy, &devices, &hospital}) {
+        endFund += seller->getFund();
+    }
+    endFund += clinic.getAmountPaidToWorkers() + pharmacy.getAmountPaidToWorkers() + devices.getAmountPaidToWorkers() +
+               hospital.getAmountPaidToWorkers();
+    EXPECT_EQ(endFund, 4 * int64_t(STRESS_FUND) - STRESS_PATIENTS * bill + totals.paid);
+    EXPECT_EQ(hospital.getNumberPatients() + clinic.getNumberPatients() + int64_t(totals.accepted), STRESS_PATIENTS);
+    EXPECT_GE(getTotalStock(clinic, ItemType::PatientHealed), 0);
+    EXPECT_GE(getTotalStock(clinic, ItemType::PatientSick), 0);
+
+    std::printf("[   STRESS ] Clinic, %d buyer(s) : %.0f requests/s, %.1f%% accepted, %.0f treatments/s\n", nbBuyers,
+                totals.requests / seconds, totals.requests ? 100.0 * totals.accepted / totals.requests : 0.0,
+                clinic.getNumberTreated() / seconds);
+}
+
+TEST_P(SellerStressTest, TestSnapshot) {
+    const int nbReaders = GetParam();
+    ExchangeSeller seller;
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> torn{0};
+
+    std::vector<std::unique_ptr<PcoThread>> readers;
+    for (int i = 0; i < nbReaders; ++i) {
+        readers.emplace_back(std::make_unique<PcoThread>([&seller, &stop, &reads, &torn]() {
+            uint64_t count = 0;
+            uint64_t inconsistent = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                SellerSnapshot snapshot = seller.getSnapshot();
+                inconsistent += snapshot.funds + snapshot.getStock(ItemType::Scalpel) != STRESS_FUND;
+                ++count;
+            }
+            reads += count;
+            torn += inconsistent;
+        }));
+    }
+
+    uint64_t writes = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(STRESS_DURATION_MS)) {
+        seller.exchange(writes % 2 ? -1 : 1);
+        ++writes;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stop = true;
+    for (auto& reader : readers) {
+        reader->join();
+    }
+
+    // Every snapshot was taken between two exchanges, never in the middle of one
+    EXPECT_EQ(torn.load(), 0u);
+    EXPECT_GT(reads.load(), 0u);
+    std::printf("[   STRESS ] Snapshot, %d reader(s) : %.0f exchanges/s, %.0f snapshots/s\n", nbReaders,
+                writes / seconds, reads / seconds);
+}
+
+TEST_P(SellerStressTest, TestSellerList) {
+    const int nbReaders = GetParam();
+    ExchangeSeller sellers[4];
+    SellerList list({&sellers[0]});
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> inconsistent{0};
+
+    std::vector<std::unique_ptr<PcoThread>> readers;
+    for (int i = 0; i < nbReaders; ++i) {
+        readers.emplace_back(std::make_unique<PcoThread>([&sellers, &list, &stop, &reads, &inconsistent]() {
+            uint64_t count = 0;
+            uint64_t wrong = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                RcuReadScope scope;
+                const std::vector<Seller*>& current = list.read();
+                // The first seller never leaves, the others join and leave one at a time
+                wrong += current.empty() || current.front() != &sellers[0] || current.size() > 2;
+                for (Seller* seller : current) {
+                    SellerSnapshot snapshot = seller->getSnapshot();
+                    wrong += snapshot.funds + snapshot.getStock(ItemType::Scalpel) != STRESS_FUND;
+                }
+                ++count;
+            }
+            reads += count;
+            inconsistent += wrong;
+        }));
+    }
+
+    // Meanwhile the listed sellers keep trading, their snapshots change under the readers
+    std::atomic<uint64_t> exchanges{0};
+    PcoThread exchanger([&list, &stop, &exchanges]() {
+        uint64_t count = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            RcuReadScope scope;
+            for (Seller* seller : list.read()) {
+                static_cast<ExchangeSeller*>(seller)->exchange(count % 2 ? -1 : 1);
+            }
+            ++count;
+        }
+        exchanges += count;
+    });
+
+    uint64_t writes = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(STRESS_DURATION_MS)) {
+        Seller* joining = &sellers[1 + writes / 2 % 3];
+        EXPECT_TRUE(writes % 2 ? list.remove(joining) : list.add(joining));
+        ++writes;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stop = true;
+    for (auto& reader : readers) {
+        reader->join();
+    }
+    exchanger.join();
+
+    // Every reader saw a whole list, before or after a change, never one being modified or freed
+    EXPECT_EQ(inconsistent.load(), 0u);
+    EXPECT_GT(reads.load(), 0u);
+    EXPECT_GT(exchanges.load(), 0u);
+    EXPECT_EQ(list.size(), 1u + writes % 2);
+    std::printf("[   STRESS ] Seller list, %d reader(s) : %.0f changes/s, %.0f reads/s\n", nbReaders,
+                writes / seconds, reads / seconds);
+}
+
+TEST_P(SellerStressTest, TestBundle) {
+    const int nbBuyers = GetParam();
+    const int nbUnits = 10000;
+    const std::vector<ItemType> items = {ItemType::Pill, ItemType::Scalpel};
+
+    std::vector<std::unique_ptr<BundleBuyer>> sellers;
+    for (int i = 0; i < 3; ++i) {
+        sellers.emplace_back(std::make_unique<BundleBuyer>(i, STRESS_FUND, items));
+        for (ItemType item : items) {
+            sellers.back()->setStock(item, nbUnits);
+        }
+    }
+    std::vector<std::unique_ptr<BundleBuyer>> buyers;
+    for (int i = 0; i < nbBuyers; ++i) {
+        buyers.emplace_back(std::make_unique<BundleBuyer>(3 + i, STRESS_FUND, items));
+    }
+
+    // Every bundle takes from the same three sellers, half of the buyers list them in the opposite order
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> bundles{0};
+    std::vector<std::unique_ptr<PcoThread>> threads;
+    for (int i = 0; i < nbBuyers; ++i) {
+        threads.emplace_back(std::make_unique<PcoThread>([&, i]() {
+            std::vector<BundleItem> bundle = {{sellers[0].get(), ItemType::Pill, 1},
+                                              {sellers[1].get(), ItemType::Scalpel, 2},
+                                              {sellers[2].get(), ItemType::Pill, 1}};
+            if (i % 2) {
+                std::reverse(bundle.begin(), bundle.end());
+            }
+            uint64_t bought = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                bought += buyers[i]->buyBundleFromSellers(bundle);
+            }
+            bundles += bought;
+        }));
+    }
+    auto start = std::chrono::steady_clock::now();
+    PcoThread::usleep(STRESS_DURATION_MS * 1000);
+    stop = true;
+    for (auto& thread : threads) {
+        thread->join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Every buyer finished, and the money and units only changed hands
+    int64_t funds = 0;
+    std::map<ItemType, int64_t> units;
+    for (auto* group : {&sellers, &buyers}) {
+        for (auto& seller : *group) {
+            funds += seller->getFund();
+            for (ItemType item : items) {
+                units[item] += seller->getSnapshot().getStock(item);
+            }
+        }
+    }
+    EXPECT_EQ(funds, int64_t(STRESS_FUND) * (3 + nbBuyers));
+    for (ItemType item : items) {
+        EXPECT_EQ(units[item], 3 * nbUnits);
+    }
+    EXPECT_GT(bundles.load(), 0u);
+    std::printf("[   STRESS ] Bundle, %d buyer(s) : %.0f bundles/s\n", nbBuyers, bundles / seconds);
+}
+
+TEST_P(SellerStressTest, TestMpscQueue) {
+    const int nbProducers = GetParam();
+    const uint64_t nbValues = 100000;
+    MpscQueue<uint64_t> queue;
+
+    // Each value carries its producer in the high bits and its rank in the low bits
+    std::vector<std::unique_ptr<PcoThread>> threads;
+    for (int i = 0; i < nbProducers; ++i) {
+        threads.emplace_back(std::make_unique<PcoThread>([&queue, i, nbValues]() {
+            for (uint64_t rank = 0; rank < nbValues; ++rank) {
+                queue.push((uint64_t(i) << 32) | rank);
+            }
+        }));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<uint64_t> nextRank(nbProducers, 0);
+    uint64_t popped = 0;
+    bool ordered = true;
+    while (popped < nbValues * nbProducers) {
+        uint64_t value;
+        if (!queue.pop(value)) {
+            std::this_thread::yield();
+            continue;
+        }
+        int producer = int(value >> 32);
+        uint64_t rank = value & 0xffffffff;
+        ASSERT_LT(producer, nbProducers);
+        // Anything lost, duplicated or overtaken breaks the sequence of its producer
+        ordered = ordered && rank == nextRank[producer];
+        nextRank[producer] = rank + 1;
+        ++popped;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (auto& thread : threads) {
+        thread->join();
+    }
+
+    EXPECT_TRUE(ordered);
+    for (int i = 0; i < nbProducers; ++i) {
+        EXPECT_EQ(nextRank[i], nbValues);
+    }
+    EXPECT_TRUE(queue.empty());
+    std::printf("[   STRESS ] MpscQueue, %d producer(s) : %.0f values/s\n", nbProducers, popped / seconds);
+}
+
+INSTANTIATE_TEST_SUITE_P(Buyers, SellerStressTest, ::testing::Values(1, 2, 4, 8));
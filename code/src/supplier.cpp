@@ -1,6 +1,11 @@
 #include "supplier.h"
 #include "costs.h"
 #include <pcosynchro/pcothread.h>
+#include "trace.h"
+#include "conservationAuditor.h"
+#include "transactionLog.h"
+#include "checkpoint.h"
+#include "placement.h"
 
 Supplier::Supplier(int uniqueId, int fund, std::vector<ItemType> resourcesSupplied)
     : SellerMutex(fund, uniqueId), resourcesSupplied(resourcesSupplied), nbSupplied(0) 
@@ -8,43 +13,69 @@ Supplier::Supplier(int uniqueId, int fund, std::vector<ItemType> resourcesSuppli
     for (const auto& item : resourcesSupplied) {    
         stocks[item] = 0;    
     }
+    publishSnapshot();
 
     updateWithMessage("Supplier Created");
 }
 
 int Supplier::request(ItemType it, int qty) {
-    if (stocks.find(it) != stocks.end()) {
-        lockMutex();
-        if (stocks[it] >= qty) {
-            stocks[it] -= qty;
-            int cost = getCostPerUnit(it) * qty;
-            money += cost;
-            unlockMutex();
-
-            updateWithMessage(QString("Sold %1 %2").arg(qty).arg(getItemName(it)));
+    ScopedLatency latency(latencies, SellerOperation::Request);
+    TraceSpan span("request", uniqueId);
 
-            return cost;
-        }
+    lockMutex();
+    if (canSell(it, qty)) {
+        int cost = sell(it, qty);
         unlockMutex();
+
+        updateWithMessage(QString("Sold %1 %2").arg(qty).arg(getItemName(it)));
+
+        return cost;
     }
+    unlockMutex();
 
+    countTrade(false);
     interfaceMessage(QString("Refused request for %1 %2").arg(qty).arg(getItemName(it)));
 
     return 0;
 }
 
+bool Supplier::canSell(ItemType it, int qty) {
+    auto stock = stocks.find(it);
+    return stock != stocks.end() && stock->second >= qty;
+}
+
+int Supplier::sell(ItemType it, int qty) {
+    stocks[it] -= qty;
+    int cost = getCostPerUnit(it) * qty;
+    money += cost;
+    ConservationAuditor::record(AuditQuantity::Funds, cost);
+    TransactionLog::append(TransactionKind::Sale, uniqueId, static_cast<int>(it), qty, cost, money);
+    countTrade(true);
+    return cost;
+}
+
 void Supplier::run() {
     interfaceMessage("[START] Supplier routine");
+    Trace::setActorName(uniqueId, QString("Supplier %1").arg(uniqueId));
+    Replay::setActor(uniqueId);
+    Placement::apply(uniqueId);
 
-    while (!finished) {
-        ItemType resourceSupplied = chooseAdequateItem();
-        int supplierCost = getEmployeeSalary(getEmployeeThatProduces(resourceSupplied));
+    while (!isFinished()) {
+        TraceSpan span("supply", uniqueId);
+        AuditScope audit;
 
         bool hasEnoughMoney = false;
 
+        // The stocks are read under the lock, the buyers change them concurrently
         lockMutex();
+        ItemType resourceSupplied = chooseAdequateItem();
+        int supplierCost = getEmployeeSalary(getEmployeeThatProduces(resourceSupplied));
         if (money >= supplierCost) {
+            // The employee is counted as paid with the same lock, getAmountPaidToWorkers never misses the salary
             money -= supplierCost;
+            nbSupplied.fetch_add(1, std::memory_order_relaxed);
+            ConservationAuditor::record(AuditQuantity::Funds, -supplierCost);
+            ConservationAuditor::record(AuditQuantity::Paid, supplierCost);
             hasEnoughMoney = true;
         }
         unlockMutex();
@@ -52,9 +83,9 @@ void Supplier::run() {
         simulateWork();
 
         if(hasEnoughMoney) {
-            ++nbSupplied;
             lockMutex();
             ++stocks[resourceSupplied];
+            TransactionLog::append(TransactionKind::Production, uniqueId, static_cast<int>(resourceSupplied), 1, -supplierCost, money);
             unlockMutex();
 
             updateWithMessage(QString("Supplied 1 %1").arg(getItemName(resourceSupplied)));
@@ -66,7 +97,7 @@ void Supplier::run() {
 
 
 std::map<ItemType, int> Supplier::getItemsForSale() {
-    return stocks;
+    return getSnapshot().toMap();
 }
 
 int Supplier::getMaterialCost() {
@@ -78,7 +109,7 @@ int Supplier::getMaterialCost() {
 }
 
 int Supplier::getAmountPaidToWorkers() {
-    return nbSupplied * getEmployeeSalary(EmployeeType::Supplier);
+    return nbSupplied.load(std::memory_order_relaxed) * getEmployeeSalary(EmployeeType::Supplier);
 }
 
 std::vector<ItemType> Supplier::getResourcesSupplied() const
@@ -108,3 +139,14 @@ ItemType Supplier::chooseAdequateItem() {
 
     return leastPresentItem;
 }
+
+void Supplier::saveState(CheckpointRecord& record, CheckpointWriter& writer) {
+    Seller::saveState(record, writer);
+    record.counters[0] = nbSupplied.load(std::memory_order_relaxed);
+}
+
+void Supplier::restoreState(const CheckpointRecord& record, const CheckpointReader& checkpoint) {
+    Seller::restoreState(record, checkpoint);
+    nbSupplied.store(record.counters[0], std::memory_order_relaxed);
+    updateInterface();
+}
@@ -66,13 +66,34 @@ public:
 
     /**
      * @brief chooseAdequateItem
-     * @return L'item le moins présent dans les stocks
+     * @return L'item le moins présent dans les stocks, le mutex doit être verrouillé
      */
     ItemType chooseAdequateItem();
 
+    /**
+     * @brief saveState
+     * Sauvegarde aussi le nombre d'items fournis
+     */
+    void saveState(CheckpointRecord& record, CheckpointWriter& writer) override;
+
+    void restoreState(const CheckpointRecord& record, const CheckpointReader& checkpoint) override;
+
 protected:
+    /**
+     * @brief canSell
+     * @return true si le fournisseur a assez de stock de l'item, le mutex doit être verrouillé
+     */
+    bool canSell(ItemType it, int qty) override;
+
+    /**
+     * @brief sell
+     * Retire les items du stock et encaisse la facture, le mutex doit être verrouillé
+     * @return La facture de la vente
+     */
+    int sell(ItemType it, int qty) override;
+
     std::vector<ItemType> resourcesSupplied;  // Liste des items que ce fournisseur gère
-    int nbSupplied;  // Nombre total d'items fournis
+    std::atomic<int> nbSupplied;  // Nombre total d'items fournis
 };
 
 
@@ -0,0 +1,315 @@
+#include "topology.h"
+#include "utils.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <random>
+#include <sstream>
+
+TopologySpec::TopologySpec()
+    : nbAmbulances(1),
+    ambulanceFund(SUPPLIER_FUND),
+    ambulancePatients(INITIAL_PATIENT_SICK),
+    nbMedicalDeviceSuppliers(1),
+    nbPharmacies(1),
+    supplierFund(SUPPLIER_FUND),
+    nbPulmonology(1),
+    nbCardiology(1),
+    nbNeurology(1),
+    clinicFund(CLINICS_FUND),
+    nbHospitals(NB_HOSPITALS),
+    hospitalFund(HOSPITALS_FUND),
+    hospitalBeds(MAX_BEDS_PER_HOSTPITAL),
+    connectivity(Connectivity::Full),
+    nbRegions(1),
+    fallbackRegions(0),
+    degree(1),
+    seed(0)
+{}
+
+bool TopologySpec::load(const QString& path) {
+    std::ifstream file(path.toStdString());
+    if (!file) {
+        std::cerr << "Cannot read the scenario " << path.toStdString() << std::endl;
+        return false;
+    }
+
+    std::map<std::string, int*> integers = {
+        {"ambulances", &nbAmbulances}, {"ambulance.fund", &ambulanceFund}, {"ambulance.patients", &ambulancePatients},
+        {"suppliers.medical", &nbMedicalDeviceSuppliers}, {"suppliers.pharmacy", &nbPharmacies}, {"supplier.fund", &supplierFund},
+        {"clinics.pulmonology", &nbPulmonology}, {"clinics.cardiology", &nbCardiology}, {"clinics.neurology", &nbNeurology},
+        {"clinic.fund", &clinicFund},
+        {"hospitals", &nbHospitals}, {"hospital.fund", &hospitalFund}, {"hospital.beds", &hospitalBeds},
+        {"regions", &nbRegions}, {"fallback", &fallbackRegions}, {"degree", &degree},
+    };
+    std::map<std::string, Connectivity> models = {
+        {"full", Connectivity::Full}, {"regional", Connectivity::Regional},
+        {"random", Connectivity::Random}, {"locality", Connectivity::Locality},
+    };
+
+    std::string line;
+    for (int lineNumber = 1; std::getline(file, line); ++lineNumber) {
+        line = line.substr(0, line.find('#'));
+        size_t equal = line.find('=');
+        std::string key, value, rest;
+        std::istringstream keyStream(line.substr(0, equal));
+        keyStream >> key;
+        if (key.empty() && equal == std::string::npos) {
+            continue;
+        }
+        std::istringstream valueStream(equal == std::string::npos ? "" : line.substr(equal + 1));
+        valueStream >> value;
+
+        bool valid = !value.empty() && !(keyStream >> rest) && !(valueStream >> rest);
+        if (valid && integers.count(key)) {
+            char* end = nullptr;
+            long number = std::strtol(value.c_str(), &end, 10);
+            valid = *end == '\0' && number >= 0 && number <= INT32_MAX;
+            *integers[key] = int(number);
+        } else if (valid && key == "connectivity") {
+            valid = models.count(value) > 0;
+            connectivity = valid ? models[value] : connectivity;
+        } else if (valid && key == "seed") {
+            char* end = nullptr;
+            seed = std::strtoull(value.c_str(), &end, 10);
+            valid = *end == '\0';
+        } else {
+            valid = false;
+        }
+
+        if (!valid) {
+            std::cerr << path.toStdString() << ":" << lineNumber << " : expected « key = value » with a known key, got « " << line << " »" << std::endl;
+            return false;
+        }
+    }
+
+    // Every clinic needs a pharmacy and a medical device supplier, and sick patients need an ambulance and a hospital
+    if (nbAmbulances < 1 || nbMedicalDeviceSuppliers < 1 || nbPharmacies < 1 || getNbClinics() < 1 || nbHospitals < 1) {
+        std::cerr << "The scenario " << path.toStdString() << " needs at least one ambulance, medical device supplier, pharmacy, clinic and hospital" << std::endl;
+        return false;
+    }
+    if (hospitalBeds < 1 || nbRegions < 1 || degree < 1) {
+        std::cerr << "The scenario " << path.toStdString() << " needs at least one bed per hospital, one region and a degree of one" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int TopologySpec::getNbSuppliers() const {
+    return nbAmbulances + nbMedicalDeviceSuppliers + nbPharmacies;
+}
+
+int TopologySpec::getNbClinics() const {
+    return nbPulmonology + nbCardiology + nbNeurology;
+}
+
+namespace {
+
+/**
+ * @brief Choisit les voisins d'une entité parmi les entités d'une sorte, selon le modèle de connexion
+ */
+class Wiring {
+public:
+    Wiring(const TopologySpec& spec, int nbRegions, std::mt19937_64& random)
+        : spec(spec), nbRegions(nbRegions), random(random) {}
+
+    /**
+     * @brief Prépare les tirages de Random pour nbSources entités voyant chacune degree entités d'une sorte
+     */
+    void prepare(int nbSources) {
+        layers.assign(spec.connectivity == Connectivity::Random ? spec.degree : 0, std::vector<int>(nbSources));
+        for (auto& layer : layers) {
+            std::iota(layer.begin(), layer.end(), 0);
+            std::shuffle(layer.begin(), layer.end(), random);
+        }
+    }
+
+    /**
+     * @return Les indices des entités, parmi nbTargets, vues par la source index parmi nbSources
+     */
+    std::vector<int> neighbours(int index, int nbSources, int nbTargets) {
+        std::vector<int> targets;
+        int64_t k = std::min(spec.degree, nbTargets);
+        switch (spec.connectivity) {
+            case Connectivity::Full:
+                targets.resize(nbTargets);
+                std::iota(targets.begin(), targets.end(), 0);
+                break;
+
+            case Connectivity::Regional: {
+                // The region of the target j is j * nbRegions / nbTargets, its members form one contiguous block
+                // Limited to distinct neighbours, at most every region once
+                int64_t fallback = std::min(spec.fallbackRegions, (nbRegions - 1) / 2);
+                for (int64_t offset = -fallback; offset <= fallback; ++offset) {
+                    int64_t region = (regionOf(index, nbSources) + offset + nbRegions) % nbRegions;
+                    for (int64_t target = (region * nbTargets + nbRegions - 1) / nbRegions;
+                         target < ((region + 1) * nbTargets + nbRegions - 1) / nbRegions; ++target) {
+                        targets.push_back(int(target));
+                    }
+                }
+                break;
+            }
+
+            case Connectivity::Random:
+                // Layer by layer, a permutation of the sources spreads them evenly over the targets
+                for (int64_t layer = 0; layer < k; ++layer) {
+                    int target = layers[layer][index] % nbTargets;
+                    while (std::find(targets.begin(), targets.end(), target) != targets.end()) {
+                        target = (target + 1) % nbTargets;
+                    }
+                    targets.push_back(target);
+                }
+                break;
+
+            case Connectivity::Locality: {
+                // Sources and targets are spread over the same ring, the k targets around the source's position are kept
+                int64_t center = int64_t(index) * nbTargets / nbSources;
+                for (int64_t offset = 0; offset < k; ++offset) {
+                    targets.push_back(int((center - k / 2 + offset + nbTargets) % nbTargets));
+                }
+                break;
+            }
+        }
+        return targets;
+    }
+
+    int regionOf(int index, int count) const {
+        return spec.connectivity == Connectivity::Regional ? int(int64_t(index) * nbRegions / count) : 0;
+    }
+
+private:
+    const TopologySpec& spec;
+    int nbRegions;
+    std::mt19937_64& random;
+    std::vector<std::vector<int>> layers;
+};
+
+template<typename T>
+std::vector<Seller*> pick(const std::vector<T*>& sellers, const std::vector<int>& indices) {
+    std::vector<Seller*> picked;
+    picked.reserve(indices.size());
+    for (int index : indices) {
+        picked.push_back(sellers[index]);
+    }
+    return picked;
+}
+
+}
+
+Topology generateTopology(const TopologySpec& spec, World& world) {
+    Topology topology;
+    std::vector<Supplier*> medicalDeviceSuppliers;
+    std::vector<Supplier*> pharmacies;
+    int id = 0;
+
+    world.ambulances.reserve(spec.nbAmbulances);
+    world.suppliers.reserve(spec.nbMedicalDeviceSuppliers + spec.nbPharmacies);
+    world.hospitals.reserve(spec.nbHospitals);
+    world.clinics.reserve(spec.getNbClinics());
+
+    for (int i = 0; i < spec.nbAmbulances; ++i) {
+        std::map<ItemType, int> initialAmbulanceStock = {{ItemType::PatientSick, spec.ambulancePatients}};
+        topology.ambulances.push_back(world.ambulances.create<Ambulance>(id++, spec.ambulanceFund, std::vector<ItemType>{ItemType::PatientSick}, initialAmbulanceStock));
+    }
+    for (int i = 0; i < spec.nbMedicalDeviceSuppliers; ++i) {
+        medicalDeviceSuppliers.push_back(world.suppliers.create<MedicalDeviceSupplier>(id++, spec.supplierFund));
+    }
+    for (int i = 0; i < spec.nbPharmacies; ++i) {
+        pharmacies.push_back(world.suppliers.create<Pharmacy>(id++, spec.supplierFund));
+    }
+    topology.suppliers = medicalDeviceSuppliers;
+    topology.suppliers.insert(topology.suppliers.end(), pharmacies.begin(), pharmacies.end());
+
+    for (int i = 0; i < spec.nbHospitals; ++i) {
+        topology.hospitals.push_back(world.hospitals.create<Hospital>(id++, spec.hospitalFund, spec.hospitalBeds));
+    }
+
+    // The specialities are interleaved, so that every region or neighbourhood gets a mix of them
+    int remaining[3] = {spec.nbPulmonology, spec.nbCardiology, spec.nbNeurology};
+    for (int i = 0, speciality = 0; i < spec.getNbClinics(); ++i, speciality = (speciality + 1) % 3) {
+        while (remaining[speciality] == 0) {
+            speciality = (speciality + 1) % 3;
+        }
+        --remaining[speciality];
+        switch (speciality) {
+            case 0:
+                topology.clinics.push_back(world.clinics.create<Pulmonology>(id++, spec.clinicFund));
+                break;
+
+            case 1:
+                topology.clinics.push_back(world.clinics.create<Cardiology>(id++, spec.clinicFund));
+                break;
+
+            case 2:
+                topology.clinics.push_back(world.clinics.create<Neurology>(id++, spec.clinicFund));
+                break;
+        }
+    }
+
+    // Every region needs a hospital, a clinic and a supplier of each kind, regions without an ambulance stay idle
+    int nbRegions = std::min({spec.nbRegions, spec.nbHospitals, spec.getNbClinics(), spec.nbMedicalDeviceSuppliers, spec.nbPharmacies});
+    std::mt19937_64 random(spec.seed);
+    Wiring wiring(spec, nbRegions, random);
+
+    int nbClinics = int(topology.clinics.size());
+    int nbHospitals = int(topology.hospitals.size());
+    std::vector<std::vector<Seller*>> clinicsOfHospital(nbHospitals);
+    std::vector<std::vector<int>> hospitalsOfClinic(nbClinics);
+    std::vector<std::vector<int>> medicalDeviceSuppliersOfClinic(nbClinics);
+    std::vector<std::vector<int>> pharmaciesOfClinic(nbClinics);
+
+    wiring.prepare(nbClinics);
+    for (int c = 0; c < nbClinics; ++c) {
+        hospitalsOfClinic[c] = wiring.neighbours(c, nbClinics, nbHospitals);
+    }
+    wiring.prepare(nbClinics);
+    for (int c = 0; c < nbClinics; ++c) {
+        medicalDeviceSuppliersOfClinic[c] = wiring.neighbours(c, nbClinics, int(medicalDeviceSuppliers.size()));
+    }
+    wiring.prepare(nbClinics);
+    for (int c = 0; c < nbClinics; ++c) {
+        pharmaciesOfClinic[c] = wiring.neighbours(c, nbClinics, int(pharmacies.size()));
+    }
+
+    for (int c = 0; c < nbClinics; ++c) {
+        std::vector<Seller*> suppliers = pick(medicalDeviceSuppliers, medicalDeviceSuppliersOfClinic[c]);
+        std::vector<Seller*> clinicPharmacies = pick(pharmacies, pharmaciesOfClinic[c]);
+        suppliers.insert(suppliers.end(), clinicPharmacies.begin(), clinicPharmacies.end());
+        topology.clinics[c]->setHospitalsAndSuppliers(pick(topology.hospitals, hospitalsOfClinic[c]), suppliers);
+        for (int h : hospitalsOfClinic[c]) {
+            // The healed patients go back to their clinic's region, even when they were bought from a fallback hospital
+            if (wiring.regionOf(h, nbHospitals) == wiring.regionOf(c, nbClinics)) {
+                clinicsOfHospital[h].push_back(topology.clinics[c]);
+            }
+        }
+    }
+
+    for (int h = 0; h < nbHospitals; ++h) {
+        topology.hospitals[h]->setClinics(clinicsOfHospital[h]);
+    }
+
+    int nbAmbulances = int(topology.ambulances.size());
+    wiring.prepare(nbAmbulances);
+    for (int a = 0; a < nbAmbulances; ++a) {
+        topology.ambulances[a]->setHospitals(pick(topology.hospitals, wiring.neighbours(a, nbAmbulances, nbHospitals)));
+    }
+
+    topology.regions.assign(id, 0);
+    auto assignRegions = [&topology, &wiring](auto& sellers) {
+        for (size_t i = 0; i < sellers.size(); ++i) {
+            int region = wiring.regionOf(int(i), int(sellers.size()));
+            sellers[i]->setRegion(region);
+            topology.regions[sellers[i]->getUniqueId()] = region;
+        }
+    };
+    assignRegions(topology.ambulances);
+    assignRegions(medicalDeviceSuppliers);
+    assignRegions(pharmacies);
+    assignRegions(topology.hospitals);
+    assignRegions(topology.clinics);
+
+    return topology;
+}
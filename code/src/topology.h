@@ -0,0 +1,101 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <cstdint>
+#include <vector>
+#include <QString>
+
+#include "supplier.h"
+#include "clinic.h"
+#include "hospital.h"
+#include "ambulance.h"
+#include "world.h"
+
+/**
+ * @brief Modèle de connexion des entités
+ * Full : chaque clinique voit tous les hôpitaux et fournisseurs, chaque ambulance tous les hôpitaux
+ * Regional : les entités sont réparties en régions contiguës, une entité voit celles de sa région et, en dernier
+ *            recours, celles des fallback régions voisines de chaque côté
+ * Random : chaque clinique voit degree hôpitaux et degree fournisseurs de chaque sorte, tirés au hasard
+ *          de manière à répartir équitablement les cliniques entre eux
+ * Locality : les entités sont placées sur un anneau, chaque clinique voit les degree plus proches de chaque sorte
+ */
+enum class Connectivity { Full, Regional, Random, Locality };
+
+/**
+ * @brief The TopologySpec struct
+ * Description d'un déploiement, lue depuis un fichier de scénario. Chaque ligne non vide est de la forme
+ * « clé = valeur », « # » commence un commentaire. Les clés absentes gardent les valeurs par défaut de utils.h :
+ *   ambulances, ambulance.fund, ambulance.patients
+ *   suppliers.medical, suppliers.pharmacy, supplier.fund
+ *   clinics.pulmonology, clinics.cardiology, clinics.neurology, clinic.fund
+ *   hospitals, hospital.fund, hospital.beds
+ *   connectivity (full, regional, random ou locality), regions, fallback, degree, seed
+ */
+struct TopologySpec {
+    TopologySpec();
+
+    int nbAmbulances;
+    int ambulanceFund;
+    int ambulancePatients;          // Patients malades confiés à chaque ambulance au départ
+
+    int nbMedicalDeviceSuppliers;
+    int nbPharmacies;
+    int supplierFund;
+
+    int nbPulmonology;
+    int nbCardiology;
+    int nbNeurology;
+    int clinicFund;
+
+    int nbHospitals;
+    int hospitalFund;
+    int hospitalBeds;
+
+    Connectivity connectivity;
+    int nbRegions;                  // Utilisé par Regional, réduit si une sorte d'entité en compte moins
+    int fallbackRegions;            // Utilisé par Regional, régions voisines servant quand la région ne peut pas servir,
+                                    // réduit pour que chaque région ne soit vue qu'une fois
+    int degree;                     // Utilisé par Random et Locality, réduit si une sorte d'entité en compte moins
+    uint64_t seed;                  // Utilisé par Random, le même fichier produit toujours le même graphe
+
+    /**
+     * @brief load
+     * @param path Fichier de scénario
+     * @return false si le fichier ne peut pas être lu ou décrit un déploiement impossible, l'erreur est affichée
+     */
+    bool load(const QString& path);
+
+    /**
+     * @brief getNbSuppliers
+     * @return Les ambulances et les fournisseurs, qui partagent le premier bloc d'identifiants comme dans utils.cpp
+     */
+    int getNbSuppliers() const;
+
+    int getNbClinics() const;
+};
+
+/**
+ * @brief The Topology struct
+ * Entités créées et reliées par generateTopology, identifiées par bloc : ambulances, fournisseurs, hôpitaux puis cliniques
+ */
+struct Topology {
+    std::vector<Ambulance*> ambulances;
+    std::vector<Supplier*> suppliers;
+    std::vector<Clinic*> clinics;
+    std::vector<Hospital*> hospitals;
+
+    std::vector<int> regions;       // Région de chaque entité indexée par identifiant, 0 hors du modèle Regional
+};
+
+/**
+ * @brief generateTopology
+ * Crée les entités décrites et les relie selon le modèle de connexion. Le coût est linéaire en nombre de liens :
+ * linéaire en nombre d'entités pour Regional, Random et Locality, quadratique pour Full qui n'est fait que pour
+ * les petits déploiements. Un hôpital rachète les patients soignés des cliniques de sa région qui le voient.
+ * La région de chaque entité lui est attribuée, ses achats y restent tant que la région peut les servir.
+ * Les entités sont créées dans les arènes de world, qui les possède.
+ */
+Topology generateTopology(const TopologySpec& spec, World& world);
+
+#endif // TOPOLOGY_H
@@ -0,0 +1,241 @@
+#include "trace.h"
+#include <pcosynchro/pcomutex.h>
+#include <pcosynchro/pcoconditionvariable.h>
+#include <pcosynchro/pcothread.h>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    uint64_t timestamp;
+    uint64_t duration;
+    uint64_t flowId;
+    int trackId;                                // Piste du thread qui a enregistré l'événement
+    int sellerId;                               // Vendeur pour le compte duquel il a été enregistré
+    char phase;
+};
+
+struct ThreadBuffer {
+    std::vector<TraceEvent> events;             // Accédé par le thread propriétaire, puis par flush() une fois terminé
+    int trackId = -1;
+};
+
+PcoMutex registryMutex;                          // Protège l'enregistrement des tampons et les noms
+std::vector<ThreadBuffer*> buffers;
+std::map<int, std::string> actorNames;
+
+PcoMutex queueMutex;                             // Protège les tampons pleins à écrire et les tampons vides à réutiliser
+PcoConditionVariable queueChanged;
+std::deque<std::vector<TraceEvent>> fullBuffers;
+std::vector<std::vector<TraceEvent>> spareBuffers;
+bool stopWriter = false;
+std::unique_ptr<PcoThread> writer;
+
+FILE* output = nullptr;                          // Écrit par le thread d'écriture pendant la simulation, puis par flush()
+bool firstEvent = true;
+std::atomic<int> nextAnonymousTrack(TRACE_ANONYMOUS_TRACK);
+const auto traceStart = std::chrono::steady_clock::now();
+
+ThreadBuffer& threadBuffer() {
+    // The buffer outlives its thread, it is owned by the registry until flush()
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        buffer = new ThreadBuffer();
+        registryMutex.lock();
+        buffers.push_back(buffer);
+        registryMutex.unlock();
+    }
+    return *buffer;
+}
+
+std::string escape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+// Only the writer thread, or flush() once it has stopped, writes to the file
+void writeEvents(std::vector<TraceEvent>& events) {
+    for (const TraceEvent& event : events) {
+        std::fprintf(output, "%s", firstEvent ? "" : ",\n");
+        firstEvent = false;
+        double timestamp = event.timestamp / 1000.0;
+        switch (event.phase) {
+            case 'X':
+                std::fprintf(output, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                             event.name, event.trackId, timestamp, event.duration / 1000.0);
+                if (event.sellerId != event.trackId) {
+                    std::fprintf(output, ",\"args\":{\"seller\":%d}", event.sellerId);
+                }
+                std::fprintf(output, "}");
+                break;
+            case 's':
+                std::fprintf(output, "{\"name\":\"%s\",\"cat\":\"trade\",\"ph\":\"s\",\"id\":%llu,\"pid\":1,\"tid\":%d,\"ts\":%.3f}",
+                             event.name, static_cast<unsigned long long>(event.flowId), event.trackId, timestamp);
+                break;
+            default:
+                std::fprintf(output, "{\"name\":\"%s\",\"cat\":\"trade\",\"ph\":\"f\",\"bp\":\"e\",\"id\":%llu,\"pid\":1,\"tid\":%d,\"ts\":%.3f}",
+                             event.name, static_cast<unsigned long long>(event.flowId), event.trackId, timestamp);
+                break;
+        }
+    }
+    events.clear();
+}
+
+void writeFullBuffers() {
+    queueMutex.lock();
+    while (true) {
+        while (fullBuffers.empty() && !stopWriter) {
+            queueChanged.wait(&queueMutex);
+        }
+        if (fullBuffers.empty()) {
+            break;
+        }
+        std::vector<TraceEvent> events = std::move(fullBuffers.front());
+        fullBuffers.pop_front();
+        queueMutex.unlock();
+
+        writeEvents(events);
+
+        // The emptied buffer keeps its capacity, the next thread to fill one takes it instead of allocating
+        queueMutex.lock();
+        spareBuffers.push_back(std::move(events));
+    }
+    queueMutex.unlock();
+}
+
+}
+
+std::atomic<bool> Trace::enabled(false);
+thread_local TraceFlow* TraceFlow::current = nullptr;
+std::atomic<uint64_t> TraceFlow::nextId(1);
+
+void Trace::enable(const QString& path) {
+    output = std::fopen(path.toStdString().c_str(), "w");
+    if (!output) {
+        std::cerr << "Cannot write the trace " << path.toStdString() << std::endl;
+        return;
+    }
+    std::fprintf(output, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    firstEvent = true;
+    stopWriter = false;
+    writer = std::make_unique<PcoThread>(writeFullBuffers);
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+void Trace::setActorName(int actorId, const QString& name) {
+    if (!isEnabled()) {
+        return;
+    }
+    threadBuffer().trackId = actorId;
+    registryMutex.lock();
+    actorNames[actorId] = name.toStdString();
+    registryMutex.unlock();
+}
+
+uint64_t Trace::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceStart).count();
+}
+
+void Trace::record(char phase, const char* name, int sellerId, uint64_t timestamp, uint64_t duration, uint64_t flowId) {
+    ThreadBuffer& buffer = threadBuffer();
+    if (buffer.trackId < 0) {
+        buffer.trackId = nextAnonymousTrack.fetch_add(1, std::memory_order_relaxed);
+    }
+    buffer.events.push_back({name, timestamp, duration, flowId, buffer.trackId, sellerId, phase});
+
+    // A full buffer is swapped for an empty one and handed to the writer thread, the traced thread never waits on the file
+    if (buffer.events.size() >= TRACE_BUFFER_EVENTS) {
+        std::vector<TraceEvent> spare;
+        queueMutex.lock();
+        fullBuffers.push_back(std::move(buffer.events));
+        if (!spareBuffers.empty()) {
+            spare = std::move(spareBuffers.back());
+            spareBuffers.pop_back();
+        }
+        queueChanged.notifyOne();
+        queueMutex.unlock();
+        buffer.events = std::move(spare);
+        buffer.events.reserve(TRACE_BUFFER_EVENTS);
+    }
+}
+
+void Trace::flush() {
+    if (!isEnabled()) {
+        return;
+    }
+    enabled.store(false, std::memory_order_relaxed);
+
+    // The writer empties the queue before it stops, the file is then only written from here
+    queueMutex.lock();
+    stopWriter = true;
+    queueChanged.notifyAll();
+    queueMutex.unlock();
+    writer->join();
+    writer.reset();
+    spareBuffers.clear();
+
+    registryMutex.lock();
+    for (ThreadBuffer* buffer : buffers) {
+        writeEvents(buffer->events);
+    }
+    for (const auto& actor : actorNames) {
+        std::fprintf(output, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                     firstEvent ? "" : ",\n", actor.first, escape(actor.second).c_str());
+        firstEvent = false;
+    }
+    std::fprintf(output, "\n]}\n");
+    std::fclose(output);
+    output = nullptr;
+    registryMutex.unlock();
+}
+
+TraceSpan::TraceSpan(const char* name, int actorId) : name(name), actorId(actorId), start(0) {
+    if (!Trace::isEnabled()) {
+        return;
+    }
+    start = Trace::now();
+
+    TraceFlow* flow = TraceFlow::current;
+    if (flow && flow->pending && flow->actorId != actorId) {
+        Trace::record('f', "trade", actorId, start, 0, flow->id);
+        flow->pending = false;
+    }
+}
+
+TraceSpan::~TraceSpan() {
+    if (!Trace::isEnabled()) {
+        return;
+    }
+    Trace::record('X', name, actorId, start, Trace::now() - start, 0);
+}
+
+TraceFlow::TraceFlow(int actorId) : id(0), actorId(actorId), pending(false), previous(current) {
+    if (!Trace::isEnabled()) {
+        return;
+    }
+    id = nextId.fetch_add(1, std::memory_order_relaxed);
+    pending = true;
+    current = this;
+    Trace::record('s', "trade", actorId, Trace::now(), 0, id);
+}
+
+TraceFlow::~TraceFlow() {
+    if (!Trace::isEnabled()) {
+        return;
+    }
+    current = previous;
+}
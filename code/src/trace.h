@@ -0,0 +1,98 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <QString>
+
+#define TRACE_BUFFER_EVENTS 8192    // Événements gardés par thread avant d'être confiés au thread d'écriture
+#define TRACE_ANONYMOUS_TRACK 1000000 // Première piste des threads qui ne sont pas des vendeurs (tests, interface)
+
+/**
+ * @brief The Trace class
+ * Enregistre des événements au format "trace event" JSON lisible par Perfetto et chrome://tracing.
+ * Chaque thread écrit dans son propre tampon borné, sans verrou. Un tampon plein est échangé contre un tampon vide et
+ * confié à un thread d'écriture, sous un verrou pris une fois tous les TRACE_BUFFER_EVENTS événements le temps de
+ * l'échange : un thread tracé n'attend jamais le fichier, seul flush() y écrit depuis l'appelant.
+ * Chaque thread a sa propre piste (tid = uniqueId de son vendeur), de sorte que les tranches d'une piste s'emboîtent
+ * toujours ; une tranche exécutée pour le compte d'un autre vendeur le nomme dans ses arguments ("seller") et reçoit
+ * la flèche de l'échange.
+ */
+class Trace {
+public:
+    /**
+     * @brief enable
+     * @param path Fichier JSON écrit pendant la simulation et terminé par flush()
+     * Doit être appelée avant le lancement des threads, la trace reste désactivée si le fichier ne peut pas être créé.
+     * Lance le thread d'écriture des tampons pleins.
+     */
+    static void enable(const QString& path);
+
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief setActorName
+     * @param actorId Identifiant du vendeur dont le thread courant exécute la routine
+     * @param name Nom affiché pour sa piste
+     * Les événements suivants du thread sont rangés sur la piste actorId.
+     */
+    static void setActorName(int actorId, const QString& name);
+
+    /**
+     * @brief flush
+     * Attend que le thread d'écriture ait vidé sa file, écrit les événements encore dans les tampons et termine le fichier.
+     * Les threads tracés doivent être terminés.
+     */
+    static void flush();
+
+private:
+    friend class TraceSpan;
+    friend class TraceFlow;
+
+    static void record(char phase, const char* name, int sellerId, uint64_t timestamp, uint64_t duration, uint64_t flowId);
+
+    static uint64_t now();
+
+    static std::atomic<bool> enabled;
+};
+
+/**
+ * @brief The TraceSpan class
+ * Tranche de durée ("X") couvrant la portée courante sur la piste du thread, pour le compte du vendeur actorId.
+ * Si un échange est en cours dans le thread (TraceFlow) et que la tranche concerne un autre vendeur,
+ * la flèche de l'échange aboutit sur cette tranche.
+ */
+class TraceSpan {
+public:
+    TraceSpan(const char* name, int actorId);
+    ~TraceSpan();
+
+private:
+    const char* name;
+    int actorId;
+    uint64_t start;
+};
+
+/**
+ * @brief The TraceFlow class
+ * Flèche d'un échange entre vendeurs : elle part de la tranche courante de l'acheteur et aboutit sur la
+ * première tranche d'un autre vendeur ouverte dans le même thread pendant la portée, sur la même piste.
+ */
+class TraceFlow {
+public:
+    explicit TraceFlow(int actorId);
+    ~TraceFlow();
+
+private:
+    friend class TraceSpan;
+
+    uint64_t id;
+    int actorId;
+    bool pending;
+    TraceFlow* previous;
+
+    static thread_local TraceFlow* current;
+    static std::atomic<uint64_t> nextId;
+};
+
+#endif // TRACE_H
@@ -0,0 +1,181 @@
+#include "transactionLog.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char TXLOG_MAGIC[8] = {'P', 'C', 'O', 'T', 'X', 'L', 'O', 'G'};
+const uint32_t TXLOG_VERSION = 1;
+const size_t SEGMENT_BYTES = TXLOG_SEGMENT_RECORDS * sizeof(TransactionRecord);
+
+int fd = -1;
+char* base = nullptr;
+size_t mappingSize = 0;
+TransactionLogHeader* header = nullptr;
+TransactionRecord* records = nullptr;
+std::atomic<uint32_t> generation(0);          // Change à chaque ouverture, invalide les segments des threads
+std::chrono::steady_clock::time_point start;
+
+struct ThreadSegment {
+    TransactionRecord* next = nullptr;
+    TransactionRecord* end = nullptr;
+    uint32_t generation = 0;
+};
+
+thread_local ThreadSegment segment;
+
+}
+
+std::atomic<bool> TransactionLog::enabled(false);
+std::atomic<uint64_t> TransactionLog::nbDropped(0);
+
+const char* getTransactionKindName(TransactionKind kind) {
+    switch (kind) {
+        case TransactionKind::Sale : return "sale";
+        case TransactionKind::Production : return "production";
+        case TransactionKind::Treatment : return "treatment";
+        case TransactionKind::Admission : return "admission";
+        case TransactionKind::Discharge : return "discharge";
+        case TransactionKind::Purchase : return "purchase";
+        case TransactionKind::Transfer : return "transfer";
+        default : return "???";
+    }
+}
+
+bool TransactionLog::open(const QString& path) {
+    std::string file = path.toStdString();
+    mappingSize = TXLOG_HEADER_SIZE + size_t(TXLOG_CAPACITY_SEGMENTS) * SEGMENT_BYTES;
+
+    fd = ::open(file.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    // The file is sparse, only the segments actually reserved take disk space
+    if (fd < 0 || ::ftruncate(fd, mappingSize) != 0) {
+        std::cerr << "Cannot create the transaction log " << file << std::endl;
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+        return false;
+    }
+
+    void* mapping = ::mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Cannot map the transaction log " << file << std::endl;
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+
+    base = static_cast<char*>(mapping);
+    header = new (base) TransactionLogHeader{};
+    std::memcpy(header->magic, TXLOG_MAGIC, sizeof(TXLOG_MAGIC));
+    header->version = TXLOG_VERSION;
+    header->recordSize = sizeof(TransactionRecord);
+    header->segmentRecords = TXLOG_SEGMENT_RECORDS;
+    header->capacitySegments = TXLOG_CAPACITY_SEGMENTS;
+    header->nbSegments.store(0, std::memory_order_relaxed);
+    records = reinterpret_cast<TransactionRecord*>(base + TXLOG_HEADER_SIZE);
+
+    start = std::chrono::steady_clock::now();
+    nbDropped.store(0, std::memory_order_relaxed);
+    generation.fetch_add(1, std::memory_order_relaxed);
+    enabled.store(true, std::memory_order_release);
+    return true;
+}
+
+void TransactionLog::write(TransactionKind kind, int seller, int item, int qty, int amount, int funds) {
+    uint32_t current = generation.load(std::memory_order_relaxed);
+    if (segment.next == segment.end || segment.generation != current) {
+        uint64_t index = header->nbSegments.fetch_add(1, std::memory_order_relaxed);
+        if (index >= TXLOG_CAPACITY_SEGMENTS) {
+            nbDropped.fetch_add(1, std::memory_order_relaxed);
+            segment = ThreadSegment();
+            return;
+        }
+        segment.next = records + index * TXLOG_SEGMENT_RECORDS;
+        segment.end = segment.next + TXLOG_SEGMENT_RECORDS;
+        segment.generation = current;
+    }
+
+    TransactionRecord* record = segment.next++;
+    record->timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    record->seller = seller;
+    record->amount = amount;
+    record->funds = funds;
+    record->qty = static_cast<uint16_t>(qty);
+    record->item = static_cast<uint8_t>(item);
+    record->reserved = 0;
+    record->kind = static_cast<uint8_t>(kind);
+}
+
+void TransactionLog::close() {
+    if (!enabled.exchange(false)) {
+        return;
+    }
+
+    uint64_t nbSegments = std::min<uint64_t>(header->nbSegments.load(std::memory_order_relaxed), TXLOG_CAPACITY_SEGMENTS);
+    header->nbSegments.store(nbSegments, std::memory_order_relaxed);
+    ::msync(base, mappingSize, MS_SYNC);
+    ::munmap(base, mappingSize);
+    if (::ftruncate(fd, TXLOG_HEADER_SIZE + nbSegments * SEGMENT_BYTES) != 0) {
+        std::cerr << "Cannot truncate the transaction log" << std::endl;
+    }
+    ::close(fd);
+
+    if (getNbDropped() > 0) {
+        std::cerr << "Transaction log full, " << getNbDropped() << " records dropped" << std::endl;
+    }
+
+    fd = -1;
+    base = nullptr;
+    header = nullptr;
+    records = nullptr;
+}
+
+TransactionLogReader::TransactionLogReader() : mapping(nullptr), mappingSize(0), records(nullptr), nbRecords(0) {}
+
+TransactionLogReader::~TransactionLogReader() {
+    if (mapping) {
+        ::munmap(mapping, mappingSize);
+    }
+}
+
+bool TransactionLogReader::open(const QString& path) {
+    std::string file = path.toStdString();
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat status;
+    if (::fstat(fd, &status) != 0 || status.st_size < TXLOG_HEADER_SIZE) {
+        ::close(fd);
+        return false;
+    }
+    mappingSize = status.st_size;
+    mapping = ::mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        return false;
+    }
+
+    const TransactionLogHeader* header = static_cast<const TransactionLogHeader*>(mapping);
+    if (std::memcmp(header->magic, TXLOG_MAGIC, sizeof(TXLOG_MAGIC)) != 0 || header->version != TXLOG_VERSION ||
+        header->recordSize != sizeof(TransactionRecord)) {
+        return false;
+    }
+
+    // A log that is still being written may announce segments beyond the end of what is mapped here
+    size_t available = (mappingSize - TXLOG_HEADER_SIZE) / sizeof(TransactionRecord);
+    nbRecords = std::min<size_t>(header->nbSegments.load(std::memory_order_relaxed) * header->segmentRecords, available);
+    records = reinterpret_cast<const TransactionRecord*>(static_cast<const char*>(mapping) + TXLOG_HEADER_SIZE);
+    return true;
+}
@@ -0,0 +1,139 @@
+#ifndef TRANSACTIONLOG_H
+#define TRANSACTIONLOG_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <QString>
+
+#define TXLOG_SEGMENT_RECORDS 1024          // Enregistrements réservés d'un coup par un thread
+#define TXLOG_CAPACITY_SEGMENTS 8192        // Taille maximale du journal en segments (fichier creux de 256 Mo)
+#define TXLOG_HEADER_SIZE 4096              // Les enregistrements commencent à la page suivant l'en-tête
+
+/**
+ * @brief Types d'enregistrements, 0 marque un emplacement réservé mais jamais écrit
+ * Purchase : achat payé par l'acheteur, Transfer : trajet d'une ambulance (patients vendus moins le salaire)
+ */
+enum class TransactionKind : uint8_t { Empty, Sale, Production, Treatment, Admission, Discharge, Purchase, Transfer, NbKinds };
+
+const char* getTransactionKindName(TransactionKind kind);
+
+/**
+ * @brief The TransactionRecord struct
+ * Un événement du point de vue de l'entité dont l'argent change : amount est la variation de son argent,
+ * funds son argent juste après l'événement. Un échange donne un enregistrement chez le vendeur et un chez l'acheteur,
+ * de sorte que l'argent de départ plus la somme des amount d'une entité donne son argent final.
+ */
+struct TransactionRecord {
+    uint64_t timestamp;     // Nanosecondes depuis l'ouverture du journal
+    uint32_t seller;
+    int32_t amount;
+    int32_t funds;
+    uint16_t qty;
+    uint8_t kind;           // TransactionKind
+    uint8_t item;           // ItemType
+    uint64_t reserved;
+};
+
+static_assert(sizeof(TransactionRecord) == 32, "The transaction log format expects 32-byte records");
+
+/**
+ * @brief The TransactionLogHeader struct
+ * Première page du fichier. nbSegments sert aussi de compteur de réservation pendant l'écriture.
+ */
+struct TransactionLogHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t segmentRecords;
+    uint32_t capacitySegments;
+    std::atomic<uint64_t> nbSegments;
+};
+
+/**
+ * @brief The TransactionLog class
+ * Journal binaire en ajout seul, projeté en mémoire. Chaque thread réserve des segments de TXLOG_SEGMENT_RECORDS
+ * enregistrements par un fetch_add sur l'en-tête puis y écrit sans synchronisation ; les emplacements d'un segment
+ * non rempli restent à zéro et sont ignorés par le lecteur. Une fois le fichier plein, les événements sont comptés comme perdus.
+ */
+class TransactionLog {
+public:
+    /**
+     * @brief open
+     * @param path Fichier du journal, remplacé s'il existe
+     * @return false si le fichier ne peut pas être créé et projeté
+     * Doit être appelée avant le lancement des threads.
+     */
+    static bool open(const QString& path);
+
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief append
+     * @param kind Type d'événement
+     * @param seller Identifiant du vendeur qui exécute l'événement
+     * @param item Item concerné
+     * @param qty Quantité
+     * @param amount Variation de l'argent du vendeur
+     * @param funds Argent du vendeur après l'événement
+     */
+    static void append(TransactionKind kind, int seller, int item, int qty, int amount, int funds) {
+        if (isEnabled()) {
+            write(kind, seller, item, qty, amount, funds);
+        }
+    }
+
+    /**
+     * @brief close
+     * Tronque le fichier aux segments réservés et le libère, les threads doivent être terminés
+     */
+    static void close();
+
+    static uint64_t getNbDropped() { return nbDropped.load(std::memory_order_relaxed); }
+
+private:
+    static void write(TransactionKind kind, int seller, int item, int qty, int amount, int funds);
+
+    static std::atomic<bool> enabled;
+    static std::atomic<uint64_t> nbDropped;
+};
+
+/**
+ * @brief The TransactionLogReader class
+ * Lecture d'un journal fermé ou en cours d'écriture, en projection mémoire en lecture seule.
+ * Les emplacements vides des segments sont conservés, les enregistrements ne sont pas triés par date.
+ */
+class TransactionLogReader {
+public:
+    TransactionLogReader();
+    ~TransactionLogReader();
+
+    TransactionLogReader(const TransactionLogReader&) = delete;
+    TransactionLogReader& operator=(const TransactionLogReader&) = delete;
+
+    /**
+     * @brief open
+     * @param path Fichier du journal
+     * @return false si le fichier n'est pas un journal valide
+     */
+    bool open(const QString& path);
+
+    /**
+     * @brief size
+     * @return Le nombre d'emplacements lisibles, y compris les emplacements vides
+     */
+    size_t size() const { return nbRecords; }
+
+    const TransactionRecord& operator[](size_t i) const { return records[i]; }
+
+    const TransactionRecord* begin() const { return records; }
+    const TransactionRecord* end() const { return records + nbRecords; }
+
+private:
+    void* mapping;
+    size_t mappingSize;
+    const TransactionRecord* records;
+    size_t nbRecords;
+};
+
+#endif // TRANSACTIONLOG_H
@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+#include "transactionLog.h"
+
+#define DEFAULT_TIMELINE_BUCKET_MS 100
+
+/**
+ * pco_txlog <journal> [timeline.csv] [intervalle en ms]
+ * Affiche le débit de chaque vendeur par type d'événement et, si un fichier CSV est donné,
+ * écrit l'argent de chaque vendeur à la fin de chaque intervalle (time_ms,seller,funds).
+ */
+
+struct SellerSummary {
+    uint64_t events[static_cast<int>(TransactionKind::NbKinds)] = {};
+    uint64_t units[static_cast<int>(TransactionKind::NbKinds)] = {};
+    int64_t amount = 0;
+    int32_t lastFunds = 0;
+};
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage : %s <log> [timeline.csv] [bucket ms]\n", argv[0]);
+        return 1;
+    }
+
+    TransactionLogReader reader;
+    if (!reader.open(argv[1])) {
+        std::fprintf(stderr, "%s is not a valid transaction log\n", argv[1]);
+        return 1;
+    }
+
+    // Each thread fills its own segments, the records are only ordered once sorted by time
+    std::vector<const TransactionRecord*> records;
+    records.reserve(reader.size());
+    size_t nbUnknown = 0;
+    for (const TransactionRecord& record : reader) {
+        // A corrupted or newer log may hold kinds this tool can't index its tables with
+        if (record.kind >= static_cast<uint8_t>(TransactionKind::NbKinds)) {
+            ++nbUnknown;
+        } else if (record.kind != static_cast<uint8_t>(TransactionKind::Empty)) {
+            records.push_back(&record);
+        }
+    }
+    if (nbUnknown > 0) {
+        std::fprintf(stderr, "Skipped %zu records of unknown kind\n", nbUnknown);
+    }
+    std::sort(records.begin(), records.end(), [](const TransactionRecord* a, const TransactionRecord* b) {
+        return a->timestamp < b->timestamp;
+    });
+
+    if (records.empty()) {
+        std::printf("Empty transaction log\n");
+        return 0;
+    }
+
+    std::map<uint32_t, SellerSummary> sellers;
+    for (const TransactionRecord* record : records) {
+        SellerSummary& summary = sellers[record->seller];
+        summary.events[record->kind] += 1;
+        summary.units[record->kind] += record->qty;
+        summary.amount += record->amount;
+        summary.lastFunds = record->funds;
+    }
+
+    double duration = std::max(records.back()->timestamp, uint64_t(1)) / 1e9;
+    std::printf("%zu records over %.3f s\n", records.size(), duration);
+    std::printf("%-8s %-12s %10s %12s %12s\n", "seller", "event", "count", "events/s", "units/s");
+    for (const auto& seller : sellers) {
+        for (int kind = 1; kind < static_cast<int>(TransactionKind::NbKinds); ++kind) {
+            if (seller.second.events[kind] == 0) {
+                continue;
+            }
+            std::printf("%-8u %-12s %10llu %12.1f %12.1f\n", seller.first,
+                        getTransactionKindName(static_cast<TransactionKind>(kind)),
+                        static_cast<unsigned long long>(seller.second.events[kind]),
+                        seller.second.events[kind] / duration, seller.second.units[kind] / duration);
+        }
+        std::printf("%-8u %-12s net %lld, funds at last event %d\n", seller.first, "funds",
+                    static_cast<long long>(seller.second.amount), seller.second.lastFunds);
+    }
+
+    if (argc < 3) {
+        return 0;
+    }
+
+    FILE* timeline = std::fopen(argv[2], "w");
+    if (!timeline) {
+        std::fprintf(stderr, "Cannot write %s\n", argv[2]);
+        return 1;
+    }
+    uint64_t bucket = uint64_t(argc > 3 ? std::max(1, std::atoi(argv[3])) : DEFAULT_TIMELINE_BUCKET_MS) * 1000000;
+
+    std::fprintf(timeline, "time_ms,seller,funds\n");
+    std::map<uint32_t, int32_t> funds;
+    size_t next = 0;
+    for (uint64_t end = bucket; next < records.size(); end += bucket) {
+        while (next < records.size() && records[next]->timestamp < end) {
+            funds[records[next]->seller] = records[next]->funds;
+            ++next;
+        }
+        for (const auto& seller : funds) {
+            std::fprintf(timeline, "%llu,%u,%d\n", static_cast<unsigned long long>(end / 1000000), seller.first, seller.second);
+        }
+    }
+    std::fclose(timeline);
+
+    return 0;
+}
@@ -1,10 +1,21 @@
 #include "utils.h"
+#include <algorithm>
+#include <chrono>
+#include "trace.h"
+#include "replay.h"
+#include "transactionLog.h"
 
 
 void Utils::endService() {
     printf("End of service\n");
 
-    // Set finished flag to true for each entity
+    // The end of service is ordered in the replay journal, a replay stops every entity at the recorded point
+    Replay::setActor(REPLAY_CONTROL_ACTOR);
+    ReplayTurn end(ReplayOp::End);
+
+    // Set finished flag to true for each entity, none is added afterwards
+    topologyMutex.lock();
+    finishing = true;
     for (auto& ambulance : ambulances) {
         ambulance->setFinished();
     }
@@ -17,28 +28,43 @@ void Utils::endService() {
     for (auto& hospital : hospitals) {
         hospital->setFinished();
     }
+    topologyMutex.unlock();
+    if (arrivalGenerator) {
+        arrivalGenerator->setFinished();
+    }
+    if (metricsExporter) {
+        metricsExporter->setFinished();
+    }
+    if (auditor) {
+        auditor->setFinished();
+    }
+    if (stateSampler) {
+        stateSampler->setFinished();
+    }
 }
 
 void Utils::externalEndService() {
+    ended = true;
     endService();
     semEnd.acquire();
     utilsThread->join();
 }
 
-std::vector<Ambulance*> createAmbulances(int nbAmbulances, int idStart){
+std::vector<Ambulance*> createAmbulances(World& world, int nbAmbulances, int idStart){
     if (nbAmbulances < 1){
         qInfo() << "Cannot make the programm work with less than 1 Supplier";
         exit(-1);
     }
 
     std::vector<Ambulance*> ambulances;
+    world.ambulances.reserve((nbAmbulances + 2) / 3);
 
     for(int i = 0; i < nbAmbulances; ++i){
         switch(i % 3) {
 
             case 0:{
                 std::map<ItemType, int> initialAmbulanceStock = {{ItemType::PatientSick, INITIAL_PATIENT_SICK}};
-                ambulances.push_back(new Ambulance(i + idStart, SUPPLIER_FUND, {ItemType::PatientSick}, initialAmbulanceStock));
+                ambulances.push_back(world.ambulances.create<Ambulance>(i + idStart, SUPPLIER_FUND, std::vector<ItemType>{ItemType::PatientSick}, initialAmbulanceStock));
                 break;
             }
         }
@@ -46,22 +72,23 @@ std::vector<Ambulance*> createAmbulances(int nbAmbulances, int idStart){
     return ambulances;
 }
 
-std::vector<Supplier*> createSuppliers(int nbSuppliers, int idStart) {
+std::vector<Supplier*> createSuppliers(World& world, int nbSuppliers, int idStart) {
     if (nbSuppliers < 1){
         qInfo() << "Cannot make the programm work with less than 1 Supplier";
         exit(-1);
     }
 
     std::vector<Supplier*> suppliers;
+    world.suppliers.reserve(nbSuppliers - (nbSuppliers + 2) / 3);
 
     for(int i = 0; i < nbSuppliers; ++i){
         switch(i % 3) {
             case 1:{
-                suppliers.push_back(new MedicalDeviceSupplier(i + idStart, SUPPLIER_FUND));
+                suppliers.push_back(world.suppliers.create<MedicalDeviceSupplier>(i + idStart, SUPPLIER_FUND));
                 break;
             }
             case 2:{
-                suppliers.push_back(new Pharmacy(i + idStart, SUPPLIER_FUND));
+                suppliers.push_back(world.suppliers.create<Pharmacy>(i + idStart, SUPPLIER_FUND));
                 break;
             }
         }
@@ -69,26 +96,27 @@ std::vector<Supplier*> createSuppliers(int nbSuppliers, int idStart) {
     return suppliers;
 }
 
-std::vector<Clinic*> createClinics(int nbClinics, int idStart) {
+std::vector<Clinic*> createClinics(World& world, int nbClinics, int idStart) {
     if (nbClinics < 1){
         qInfo() << "Cannot make the programm work with less than 1 Clinic";
         exit(-1);
     }
 
     std::vector<Clinic*> clinics;
+    world.clinics.reserve(nbClinics);
 
     for(int i = 0; i < nbClinics; ++i) {
         switch(i % 3) {
             case 0:
-                clinics.push_back(new Pulmonology(i + idStart, CLINICS_FUND));
+                clinics.push_back(world.clinics.create<Pulmonology>(i + idStart, CLINICS_FUND));
                 break;
 
             case 1:
-                clinics.push_back(new Cardiology(i + idStart, CLINICS_FUND));
+                clinics.push_back(world.clinics.create<Cardiology>(i + idStart, CLINICS_FUND));
                 break;
 
             case 2:
-                clinics.push_back(new Neurology(i + idStart, CLINICS_FUND));
+                clinics.push_back(world.clinics.create<Neurology>(i + idStart, CLINICS_FUND));
                 break;
         }
     }
@@ -97,22 +125,23 @@ std::vector<Clinic*> createClinics(int nbClinics, int idStart) {
     return clinics;
 }
 
-std::vector<Hospital*> createHospitals(int nbHospital, int idStart) {
+std::vector<Hospital*> createHospitals(World& world, int nbHospital, int idStart) {
     if(nbHospital < 1){
         qInfo() << "Cannot launch the programm without any hospitalr";
         exit(-1);
     }
     std::vector<Hospital*> hospitals;
+    world.hospitals.reserve(nbHospital);
 
     for(int i = 0; i < nbHospital; ++i){
-        hospitals.push_back(new Hospital(i + idStart, HOSPITALS_FUND, MAX_BEDS_PER_HOSTPITAL));
+        hospitals.push_back(world.hospitals.create<Hospital>(i + idStart, HOSPITALS_FUND, MAX_BEDS_PER_HOSTPITAL));
     }
 
     return hospitals;
 }
 
 
-Utils::Utils(int nbSupplier, int nbClinic, int nbHospital) {
+Utils::Utils(int nbSupplier, int nbClinic, int nbHospital) : world(std::make_unique<World>()) {
     int nbAmbulances = nbSupplier / 3;
     if (nbSupplier % 3 != 0) {
         nbAmbulances += 1;
@@ -122,10 +151,10 @@ Utils::Utils(int nbSupplier, int nbClinic, int nbHospital) {
     this->hospitals.resize(nbHospital);
     this->clinics.resize(nbClinic);
 
-    this->ambulances = createAmbulances(nbSupplier, 0);
-    this->suppliers = createSuppliers(nbSupplier, 0);
-    this->hospitals = createHospitals(nbHospital, nbSupplier);
-    this->clinics = createClinics(nbClinic, nbSupplier + nbHospital);
+    this->ambulances = createAmbulances(*world, nbSupplier, 0);
+    this->suppliers = createSuppliers(*world, nbSupplier, 0);
+    this->hospitals = createHospitals(*world, nbHospital, nbSupplier);
+    this->clinics = createClinics(*world, nbClinic, nbSupplier + nbHospital);
 
     int clinicsByHospital = nbClinic / nbHospital;
     int clinicsShared = nbClinic % nbHospital;
@@ -162,10 +191,85 @@ Utils::Utils(int nbSupplier, int nbClinic, int nbHospital) {
         c->setHospitalsAndSuppliers(tmpHospitals, tmpSuppliers);
     }
 
+    start();
+}
+
+Utils::Utils(const TopologySpec& spec) : world(std::make_unique<World>()) {
+    Topology topology = generateTopology(spec, *world);
+    ambulances = topology.ambulances;
+    suppliers = topology.suppliers;
+    clinics = topology.clinics;
+    hospitals = topology.hospitals;
+
+    start();
+}
+
+Utils::~Utils() {
+    // The entities die with the world, their threads must be done with them first
+    if (!ended) {
+        externalEndService();
+    }
+}
+
+void Utils::start() {
+    for (Seller* seller : getSellers()) {
+        initialFund += seller->getFund();
+    }
+    for (Ambulance* ambulance : ambulances) {
+        initialPatients += ambulance->getNumberPatients();
+    }
+    for (Seller* seller : getSellers()) {
+        nextId = std::max(nextId, seller->getUniqueId() + 1);
+    }
+
+    if (!Checkpoint::getLoadPath().empty()) {
+        loadCheckpoint(QString::fromStdString(Checkpoint::getLoadPath()));
+    }
+
+    // Placed once the wiring is final, a checkpoint restores its own
+    Placement::plan(getSellers());
+
+    if (PatientArrivalGenerator::isEnabled()) {
+        arrivalGenerator = std::make_unique<PatientArrivalGenerator>(ambulances);
+    }
+
+    if (CONSERVATION_AUDIT_PERIOD_MS > 0) {
+        auditor = std::make_unique<ConservationAuditor>(CONSERVATION_AUDIT_PERIOD_MS);
+    }
+
+    if (MetricsExporter::isEnabled()) {
+        metricsExporter = std::make_unique<MetricsExporter>(ambulances, suppliers, clinics, hospitals);
+    }
+
+    if (StateSampler::isEnabled()) {
+        stateSampler = std::make_unique<StateSampler>(ambulances, suppliers, clinics, hospitals);
+    }
+
     utilsThread = std::make_unique<PcoThread>(&Utils::run, this);
 }
 
 void Utils::run() {
+    auto start = std::chrono::steady_clock::now();
+
+    if (arrivalGenerator) {
+        threads.emplace_back(std::make_unique<PcoThread>(&PatientArrivalGenerator::run, arrivalGenerator.get()));
+    }
+
+    if (metricsExporter) {
+        threads.emplace_back(std::make_unique<PcoThread>(&MetricsExporter::run, metricsExporter.get()));
+    }
+
+    if (auditor) {
+        threads.emplace_back(std::make_unique<PcoThread>(&ConservationAuditor::run, auditor.get()));
+    }
+
+    if (stateSampler) {
+        threads.emplace_back(std::make_unique<PcoThread>(&StateSampler::run, stateSampler.get()));
+    }
+
+    // Entities added from now on start their own thread
+    topologyMutex.lock();
+    running = true;
 
     for(size_t i = 0; i < ambulances.size(); ++i) {
         threads.emplace_back(std::make_unique<PcoThread>(&Ambulance::run, ambulances[i]));
@@ -182,55 +286,360 @@ void Utils::run() {
     for(size_t i = 0; i < hospitals.size(); ++i) {
         threads.emplace_back(std::make_unique<PcoThread>(&Hospital::run, hospitals[i]));
     }
+    topologyMutex.unlock();
 
     for (auto& thread : threads) {
         thread->join();
     }
-    
-    int startPatient = INITIAL_PATIENT_SICK;
 
-    int endPatient = 0;
+    // Once the end of service is requested no entity is added, the list of added threads is final
+    topologyMutex.lock();
+    std::vector<std::unique_ptr<PcoThread>> added = std::move(addedThreads);
+    topologyMutex.unlock();
+    for (auto& thread : added) {
+        thread->join();
+    }
+
+    Trace::flush();
+    Replay::flush();
+    TransactionLog::close();
+
+    double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
+    int arrivals = arrivalGenerator ? arrivalGenerator->getNbArrivals() : 0;
 
+    int startPatient = getInitialPatients() + int(restoredArrivals) + arrivals;
 
-    int startFund = (SUPPLIER_FUND * int(ambulances.size())) +
-                    (SUPPLIER_FUND * int(suppliers.size())) +
-                    (CLINICS_FUND * int(clinics.size())) +
-                    (HOSPITALS_FUND * int(hospitals.size()));
+    // One pass over the entities, the totals are then read from contiguous columns
+    WorldView view;
+    view.capture(ambulances, suppliers, clinics, hospitals);
 
-    int endFund = 0;
+    int64_t startFund = initialFund + view.getTotalFundingFromHealed();
+    int64_t endFund = view.getTotalFunds() + view.getTotalPaidToWorkers();
+    int64_t endPatient = view.getTotalPatients();
+    int64_t discharged = view.getTotalDischarged();
 
-    for (Ambulance* ambulance: ambulances) {
-        endFund += ambulance->getFund();
-        endFund += ambulance->getAmountPaidToWorkers();
-        endPatient += ambulance->getNumberPatients();
+    finalReport = QString("The expected fund is : %1 and you got at the end : %2\n").arg(startFund).arg(endFund);
+    finalReport += QString("The expected patient is : %1 and you got at the end : %2").arg(startPatient).arg(endPatient);
+    finalReport += "\n" + view.report();
+
+    uint64_t tradesAccepted = 0;
+    uint64_t tradesCrossRegion = 0;
+    int nbRegions = 1;
+    for (Seller* seller : getSellers()) {
+        tradesAccepted += seller->getTradesAccepted();
+        tradesCrossRegion += seller->getTradesCrossRegion();
+        nbRegions = std::max(nbRegions, seller->getRegion() + 1);
+    }
+    if (nbRegions > 1) {
+        finalReport += QString("\nCross-region trades : %1 of %2 accepted trades, over %3 regions")
+                           .arg(tradesCrossRegion).arg(tradesAccepted).arg(nbRegions);
     }
 
-    for (Supplier* supplier: suppliers) {
-        endFund += supplier->getFund();
-        endFund += supplier->getAmountPaidToWorkers();
+    if (arrivalGenerator) {
+        finalReport += QString("\nOffered load : %1 patients (%2/s) over %3 s, discharged : %4 patients (%5/s)")
+                           .arg(arrivals).arg(arrivalGenerator->getRatePerSecond())
+                           .arg(duration, 0, 'f', 1)
+                           .arg(discharged).arg(discharged / duration, 0, 'f', 2);
     }
 
-    for (Clinic* clinic: clinics) {
-        endFund += clinic->getFund();
-        endFund += clinic->getAmountPaidToWorkers();
-        endPatient += clinic->getNumberPatients();
+    if (Replay::isActive()) {
+        finalReport += "\n" + Replay::report();
+        qInfo().noquote() << Replay::report();
     }
 
-    for (Hospital* hospital: hospitals) {
-        endFund += hospital->getFund();
-        endFund += hospital->getAmountPaidToWorkers();
-        startFund += hospital->getFundingFromHealed();
-        endPatient += hospital->getNumberPatients();
+    if (auditor) {
+        QString audit = auditor->report();
+        finalReport += "\n" + audit;
+        qInfo().noquote() << audit;
     }
 
-    finalReport = QString("The expected fund is : %1 and you got at the end : %2\n").arg(startFund).arg(endFund);
-    finalReport += QString("The expected patient is : %1 and you got at the end : %2").arg(startPatient).arg(endPatient);
+    if (!Checkpoint::getSavePath().empty()) {
+        QString saved = QString::fromStdString(Checkpoint::getSavePath());
+        QString checkpoint = saveCheckpoint(saved, restoredArrivals + arrivals) ? "Checkpoint saved to " + saved : "Checkpoint could not be saved to " + saved;
+        finalReport += "\n" + checkpoint;
+        qInfo().noquote() << checkpoint;
+    }
+
+    if (stateSampler) {
+        finalReport += "\n" + stateSampler->report();
+        qInfo().noquote() << stateSampler->report();
+    }
+
+    finalReport += "\n" + Placement::report();
+    qInfo().noquote() << Placement::report();
+
+    QString latencies = PatientTracker::report() + "\n" + latencyReport() + "\n" + InstrumentedMutex::report(LOCK_REPORT_MAX_LOCKS);
+    finalReport += "\n" + latencies;
 
     qInfo() << "The expected fund is : " << startFund << " and you got at the end : " << endFund;
+    qInfo().noquote() << latencies;
     semEnd.release();
 }
 
+std::vector<Seller*> Utils::getSellers() {
+    std::vector<Seller*> sellers;
+    topologyMutex.lock();
+    sellers.insert(sellers.end(), ambulances.begin(), ambulances.end());
+    sellers.insert(sellers.end(), suppliers.begin(), suppliers.end());
+    sellers.insert(sellers.end(), clinics.begin(), clinics.end());
+    sellers.insert(sellers.end(), hospitals.begin(), hospitals.end());
+    topologyMutex.unlock();
+    return sellers;
+}
+
+int Utils::getInitialPatients() {
+    return initialPatients;
+}
+
+int Utils::getNumberDischarged() {
+    int discharged = 0;
+    topologyMutex.lock();
+    for (Hospital* hospital : hospitals) {
+        discharged += hospital->getNumberDischarged();
+    }
+    topologyMutex.unlock();
+    return discharged;
+}
+
+template<typename T>
+void Utils::launch(T* seller) {
+    initialFund += seller->getFund();
+    if (running) {
+        addedThreads.emplace_back(std::make_unique<PcoThread>(&T::run, seller));
+    }
+}
+
+Hospital* Utils::addHospital(int region) {
+    topologyMutex.lock();
+    if (finishing) {
+        topologyMutex.unlock();
+        return nullptr;
+    }
+    Hospital* hospital = world->hospitals.create<Hospital>(nextId++, HOSPITALS_FUND, MAX_BEDS_PER_HOSTPITAL);
+    hospital->setRegion(region);
+
+    std::vector<Seller*> regionClinics;
+    for (Clinic* clinic : clinics) {
+        if (clinic->getRegion() == region) {
+            regionClinics.push_back(clinic);
+        }
+    }
+    hospital->setClinics(regionClinics);
+    hospitals.push_back(hospital);
+    launch(hospital);
+
+    // Published last, nobody sends patients to the hospital before it is wired
+    for (Seller* clinic : regionClinics) {
+        static_cast<Clinic*>(clinic)->addHospital(hospital);
+    }
+    for (Ambulance* ambulance : ambulances) {
+        if (ambulance->getRegion() == region) {
+            ambulance->addHospital(hospital);
+        }
+    }
+    topologyMutex.unlock();
+    return hospital;
+}
+
+Clinic* Utils::addClinic(int region) {
+    topologyMutex.lock();
+    if (finishing) {
+        topologyMutex.unlock();
+        return nullptr;
+    }
+    Clinic* clinic = nullptr;
+    switch (clinics.size() % 3) {
+        case 0:
+            clinic = world->clinics.create<Pulmonology>(nextId++, CLINICS_FUND);
+            break;
+        case 1:
+            clinic = world->clinics.create<Cardiology>(nextId++, CLINICS_FUND);
+            break;
+        case 2:
+            clinic = world->clinics.create<Neurology>(nextId++, CLINICS_FUND);
+            break;
+    }
+    clinic->setRegion(region);
+
+    std::vector<Seller*> regionHospitals;
+    std::vector<Seller*> regionSuppliers;
+    for (Hospital* hospital : hospitals) {
+        if (hospital->getRegion() == region) {
+            regionHospitals.push_back(hospital);
+        }
+    }
+    for (Supplier* supplier : suppliers) {
+        if (supplier->getRegion() == region) {
+            regionSuppliers.push_back(supplier);
+        }
+    }
+    clinic->setHospitalsAndSuppliers(regionHospitals, regionSuppliers);
+    // The hospitals subscribe to the clinic before it treats its first patient
+    for (Seller* hospital : regionHospitals) {
+        static_cast<Hospital*>(hospital)->addClinic(clinic);
+    }
+    clinics.push_back(clinic);
+    launch(clinic);
+    topologyMutex.unlock();
+    return clinic;
+}
+
+Supplier* Utils::addSupplier(int region) {
+    topologyMutex.lock();
+    if (finishing) {
+        topologyMutex.unlock();
+        return nullptr;
+    }
+    Supplier* supplier = nullptr;
+    if (suppliers.size() % 2 == 0) {
+        supplier = world->suppliers.create<MedicalDeviceSupplier>(nextId++, SUPPLIER_FUND);
+    } else {
+        supplier = world->suppliers.create<Pharmacy>(nextId++, SUPPLIER_FUND);
+    }
+    supplier->setRegion(region);
+    suppliers.push_back(supplier);
+    launch(supplier);
+
+    for (Clinic* clinic : clinics) {
+        if (clinic->getRegion() == region) {
+            clinic->addSupplier(supplier);
+        }
+    }
+    topologyMutex.unlock();
+    return supplier;
+}
+
+void Utils::drain(Seller* seller) {
+    topologyMutex.lock();
+    // Only the inflow is cut, the clinics keep treating a hospital's sick patients and handing healed ones back
+    if (dynamic_cast<Hospital*>(seller)) {
+        for (Ambulance* ambulance : ambulances) {
+            ambulance->removeHospital(seller);
+        }
+    } else if (Clinic* clinic = dynamic_cast<Clinic*>(seller)) {
+        clinic->drain();
+    } else if (dynamic_cast<Supplier*>(seller)) {
+        for (Clinic* clinic : clinics) {
+            clinic->removeSupplier(seller);
+        }
+    }
+    topologyMutex.unlock();
+}
+
+std::vector<CheckpointKind> Utils::getCheckpointKinds() {
+    std::vector<CheckpointKind> kinds;
+    kinds.insert(kinds.end(), ambulances.size(), CheckpointKind::Ambulance);
+    kinds.insert(kinds.end(), suppliers.size(), CheckpointKind::Supplier);
+    kinds.insert(kinds.end(), clinics.size(), CheckpointKind::Clinic);
+    kinds.insert(kinds.end(), hospitals.size(), CheckpointKind::Hospital);
+    return kinds;
+}
+
+void Utils::loadCheckpoint(const QString& path) {
+    CheckpointReader checkpoint;
+    if (!checkpoint.open(path)) {
+        qInfo() << "Cannot load the checkpoint" << path;
+        exit(-1);
+    }
+
+    // The entities are created from the configuration, the checkpoint must describe the same ones in the same order
+    std::vector<Seller*> sellers = getSellers();
+    std::vector<CheckpointKind> kinds = getCheckpointKinds();
+    std::map<int, Seller*> sellersById;
+    bool matches = checkpoint.size() == sellers.size();
+    for (size_t i = 0; matches && i < sellers.size(); ++i) {
+        matches = checkpoint[i].uniqueId == uint32_t(sellers[i]->getUniqueId()) && checkpoint[i].kind == uint32_t(kinds[i]);
+        sellersById[sellers[i]->getUniqueId()] = sellers[i];
+    }
+    if (!matches || !checkpoint.setSellers(sellersById)) {
+        qInfo() << "The checkpoint" << path << "does not match the configured suppliers, clinics and hospitals";
+        exit(-1);
+    }
+
+    // The auditor only sees variations, the restored state is published as one
+    auto totals = [this]() {
+        std::array<int64_t, static_cast<int>(AuditQuantity::NbQuantities)> totals{};
+        auto add = [&totals](AuditQuantity quantity, int64_t value) { totals[static_cast<int>(quantity)] += value; };
+        for (Ambulance* ambulance : ambulances) {
+            add(AuditQuantity::Funds, ambulance->getFund());
+            add(AuditQuantity::Paid, ambulance->getAmountPaidToWorkers());
+            add(AuditQuantity::Patients, ambulance->getNumberPatients());
+        }
+        for (Supplier* supplier : suppliers) {
+            add(AuditQuantity::Funds, supplier->getFund());
+            add(AuditQuantity::Paid, supplier->getAmountPaidToWorkers());
+        }
+        for (Clinic* clinic : clinics) {
+            add(AuditQuantity::Funds, clinic->getFund());
+            add(AuditQuantity::Paid, clinic->getAmountPaidToWorkers());
+            add(AuditQuantity::Patients, clinic->getNumberPatients());
+        }
+        for (Hospital* hospital : hospitals) {
+            add(AuditQuantity::Funds, hospital->getFund());
+            add(AuditQuantity::Paid, hospital->getAmountPaidToWorkers());
+            add(AuditQuantity::Income, hospital->getFundingFromHealed());
+            add(AuditQuantity::Patients, hospital->getNumberPatients());
+        }
+        return totals;
+    };
+
+    AuditScope audit;
+    auto before = totals();
+    for (size_t i = 0; i < sellers.size(); ++i) {
+        sellers[i]->restoreState(checkpoint[i], checkpoint);
+    }
+    auto after = totals();
+    for (int quantity = 0; quantity < static_cast<int>(AuditQuantity::NbQuantities); ++quantity) {
+        ConservationAuditor::record(static_cast<AuditQuantity>(quantity), after[quantity] - before[quantity]);
+    }
+    restoredArrivals = checkpoint.getNbArrivals();
+    ConservationAuditor::record(AuditQuantity::Arrivals, restoredArrivals);
+
+    qInfo().noquote() << QString("Restored %1 entities from the checkpoint %2").arg(sellers.size()).arg(path);
+}
+
+bool Utils::saveCheckpoint(const QString& path, uint64_t nbArrivals) {
+    CheckpointWriter writer;
+    std::vector<Seller*> sellers = getSellers();
+    std::vector<CheckpointKind> kinds = getCheckpointKinds();
+    for (size_t i = 0; i < sellers.size(); ++i) {
+        sellers[i]->saveState(writer.addRecord(kinds[i]), writer);
+    }
+    return writer.write(path, nbArrivals);
+}
+
+QString Utils::latencyReport() {
+    const int nbOperations = static_cast<int>(SellerOperation::NbOperations);
+    std::vector<Seller*> sellers = getSellers();
+    bool detailed = sellers.size() <= LATENCY_REPORT_MAX_SELLERS;
+
+    QString report = "Seller latencies :";
+    std::vector<LatencyHistogram> totals(nbOperations);
+
+    for (Seller* seller : sellers) {
+        for (int op = 0; op < nbOperations; ++op) {
+            const LatencyHistogram* histogram = seller->getLatencies().get(static_cast<SellerOperation>(op));
+            if (!histogram) {
+                continue;
+            }
+            totals[op].merge(*histogram);
+            if (detailed) {
+                report += QString("\n  seller %1 %2 : %3").arg(seller->getUniqueId())
+                              .arg(getOperationName(static_cast<SellerOperation>(op))).arg(histogram->summary());
+            }
+        }
+    }
+
+    for (int op = 0; op < nbOperations; ++op) {
+        if (totals[op].getCount() > 0) {
+            report += QString("\n  all sellers %1 : %2").arg(getOperationName(static_cast<SellerOperation>(op))).arg(totals[op].summary());
+        }
+    }
+
+    return report;
+}
+
 QString Utils::getFinalReport()
 {
     return finalReport;
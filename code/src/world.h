@@ -0,0 +1,125 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "supplier.h"
+#include "clinic.h"
+#include "hospital.h"
+#include "ambulance.h"
+
+#define WORLD_CACHE_LINE 64             // Taille d'une ligne de cache, chaque entité commence sur sa propre ligne
+#define WORLD_MIN_BLOCK_SLOTS 16        // Emplacements alloués au minimum quand une arène est pleine sans réservation
+
+/**
+ * @brief The Arena class
+ * Range les entités d'une même famille les unes à la suite des autres dans de grands blocs alignés sur les lignes de
+ * cache. Chaque emplacement fait SlotSize octets arrondis à la ligne de cache, deux entités voisines ne partagent donc
+ * jamais une ligne. Les entités vivent jusqu'à la destruction de l'arène, qui les détruit dans l'ordre inverse de leur
+ * création puis libère les blocs. Une arène n'est pas protégée, les entités sont créées avant le lancement des threads.
+ */
+template<typename Base, size_t SlotSize>
+class Arena {
+public:
+    static constexpr size_t slotSize = (SlotSize + WORLD_CACHE_LINE - 1) / WORLD_CACHE_LINE * WORLD_CACHE_LINE;
+
+    Arena() = default;
+
+    ~Arena() {
+        for (auto it = objects.rbegin(); it != objects.rend(); ++it) {
+            (*it)->~Base();
+        }
+        for (auto& block : blocks) {
+            std::free(block.first);
+        }
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /**
+     * @brief reserve
+     * @param count Entités qui seront encore créées, placées ensemble dans un seul bloc
+     */
+    void reserve(size_t count) {
+        if (count > available()) {
+            allocate(count);
+        }
+    }
+
+    /**
+     * @brief create
+     * @param args Arguments du constructeur de T
+     * @return La nouvelle entité, détruite avec l'arène et jamais par delete
+     */
+    template<typename T, typename... Args>
+    T* create(Args&&... args) {
+        static_assert(std::is_base_of<Base, T>::value, "The arena only holds one family of entities");
+        static_assert(sizeof(T) <= slotSize && alignof(T) <= WORLD_CACHE_LINE, "The entity does not fit in a slot");
+        if (available() == 0) {
+            allocate(std::max<size_t>(WORLD_MIN_BLOCK_SLOTS, blocks.empty() ? 0 : blocks.back().second));
+        }
+        void* slot = blocks.back().first + used * slotSize;
+        T* object = new (slot) T(std::forward<Args>(args)...);
+        ++used;
+        objects.push_back(object);
+        return object;
+    }
+
+    size_t size() const { return objects.size(); }
+
+    /**
+     * @brief getBytes
+     * @return Les octets alloués par l'arène pour les entités elles-mêmes, hors mémoire qu'elles allouent
+     */
+    size_t getBytes() const {
+        size_t bytes = 0;
+        for (const auto& block : blocks) {
+            bytes += block.second * slotSize;
+        }
+        return bytes;
+    }
+
+private:
+    std::vector<std::pair<char*, size_t>> blocks; // Début et nombre d'emplacements de chaque bloc
+    size_t used = 0;                              // Emplacements occupés dans le dernier bloc
+    std::vector<Base*> objects;
+
+    size_t available() const {
+        return blocks.empty() ? 0 : blocks.back().second - used;
+    }
+
+    void allocate(size_t count) {
+        char* block = static_cast<char*>(std::aligned_alloc(WORLD_CACHE_LINE, count * slotSize));
+        if (!block) {
+            throw std::bad_alloc();
+        }
+        blocks.emplace_back(block, count);
+        used = 0;
+    }
+};
+
+/**
+ * @brief The World class
+ * Possède toutes les entités de la simulation, une arène par famille : les ambulances, les fournisseurs, les cliniques
+ * et les hôpitaux sont chacun contigus en mémoire. Le monde entier est libéré d'un coup à sa destruction, une fois
+ * les threads des entités terminés.
+ */
+class World {
+public:
+    Arena<Ambulance, sizeof(Ambulance)> ambulances;
+    Arena<Supplier, std::max(sizeof(MedicalDeviceSupplier), sizeof(Pharmacy))> suppliers;
+    Arena<Clinic, std::max({sizeof(Pulmonology), sizeof(Cardiology), sizeof(Neurology)})> clinics;
+    Arena<Hospital, sizeof(Hospital)> hospitals;
+
+    size_t getBytes() const {
+        return ambulances.getBytes() + suppliers.getBytes() + clinics.getBytes() + hospitals.getBytes();
+    }
+};
+
+#endif // WORLD_H
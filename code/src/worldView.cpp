@@ -0,0 +1,118 @@
+#include "worldView.h"
+#include <algorithm>
+
+namespace WorldKernels {
+
+int64_t sum(const int32_t* values, size_t count) {
+    int64_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        total += values[i];
+    }
+    return total;
+}
+
+void minMax(const int32_t* values, size_t count, int32_t& min, int32_t& max) {
+    if (count == 0) {
+        min = max = 0;
+        return;
+    }
+    int32_t low = values[0];
+    int32_t high = values[0];
+    for (size_t i = 1; i < count; ++i) {
+        low = std::min(low, values[i]);
+        high = std::max(high, values[i]);
+    }
+    min = low;
+    max = high;
+}
+
+void occupancyHistogram(const int32_t* occupied, const int32_t* capacity, size_t count, uint64_t* bins, int nbBins) {
+    std::fill(bins, bins + nbBins + 1, 0);
+    int32_t chunk[WORLD_VIEW_KERNEL_CHUNK];
+    for (size_t start = 0; start < count; start += WORLD_VIEW_KERNEL_CHUNK) {
+        size_t size = std::min<size_t>(WORLD_VIEW_KERNEL_CHUNK, count - start);
+
+        // The bins are computed without branches, in double precision which is exact for any bed count of an int,
+        // then counted. A hospital without beds is full, the bin of a full hospital is nbBins
+        for (size_t i = 0; i < size; ++i) {
+            double beds = std::max(capacity[start + i], 1);
+            double bin = capacity[start + i] > 0 ? double(occupied[start + i]) * nbBins / beds : nbBins;
+            chunk[i] = int32_t(std::min(std::max(bin, 0.0), double(nbBins)));
+        }
+        for (size_t i = 0; i < size; ++i) {
+            ++bins[chunk[i]];
+        }
+    }
+}
+
+}
+
+template<typename T>
+void WorldView::captureSellers(const std::vector<T*>& sellers, size_t& index) {
+    for (T* seller : sellers) {
+        SellerSnapshot state = seller->getSnapshot();
+        funds[index] = state.funds;
+        for (int item = 0; item < NB_ITEM_TYPES; ++item) {
+            stocks[item][index] = state.stocks[item];
+        }
+        paidToWorkers[index] = seller->getAmountPaidToWorkers();
+        patients[index] = patientsOf(seller);
+        ++index;
+    }
+}
+
+void WorldView::capture(const std::vector<Ambulance*>& ambulances, const std::vector<Supplier*>& suppliers,
+                        const std::vector<Clinic*>& clinics, const std::vector<Hospital*>& hospitals) {
+    size_t nbSellers = ambulances.size() + suppliers.size() + clinics.size() + hospitals.size();
+    funds.resize(nbSellers);
+    paidToWorkers.resize(nbSellers);
+    patients.resize(nbSellers);
+    for (auto& column : stocks) {
+        column.resize(nbSellers);
+    }
+    occupiedBeds.resize(hospitals.size());
+    beds.resize(hospitals.size());
+    discharged.resize(hospitals.size());
+    fundingFromHealed.resize(hospitals.size());
+
+    size_t index = 0;
+    captureSellers(ambulances, index);
+    captureSellers(suppliers, index);
+    captureSellers(clinics, index);
+    captureSellers(hospitals, index);
+
+    for (size_t h = 0; h < hospitals.size(); ++h) {
+        occupiedBeds[h] = hospitals[h]->getOccupiedBeds();
+        beds[h] = hospitals[h]->getMaxBeds();
+        discharged[h] = hospitals[h]->getNumberDischarged();
+        fundingFromHealed[h] = hospitals[h]->getFundingFromHealed();
+    }
+}
+
+int64_t WorldView::getTotalStock(ItemType item) const {
+    const auto& column = stocks[static_cast<int>(item)];
+    return WorldKernels::sum(column.data(), column.size());
+}
+
+std::array<uint64_t, WORLD_VIEW_OCCUPANCY_BINS + 1> WorldView::getOccupancyHistogram() const {
+    std::array<uint64_t, WORLD_VIEW_OCCUPANCY_BINS + 1> bins;
+    WorldKernels::occupancyHistogram(occupiedBeds.data(), beds.data(), beds.size(), bins.data(), WORLD_VIEW_OCCUPANCY_BINS);
+    return bins;
+}
+
+QString WorldView::report() const {
+    int32_t minFunds = 0;
+    int32_t maxFunds = 0;
+    getFundsRange(minFunds, maxFunds);
+
+    QString histogram;
+    for (uint64_t count : getOccupancyHistogram()) {
+        histogram += (histogram.isEmpty() ? "" : " ") + QString::number(count);
+    }
+
+    return QString("World : %1 entities, funds %2 (min %3, max %4), %5 patients, %6/%7 beds occupied, "
+                   "hospitals by occupancy per %8% : %9")
+        .arg(size()).arg(getTotalFunds()).arg(minFunds).arg(maxFunds)
+        .arg(getTotalPatients()).arg(getTotalOccupiedBeds()).arg(getTotalBeds())
+        .arg(100 / WORLD_VIEW_OCCUPANCY_BINS).arg(histogram);
+}
@@ -0,0 +1,122 @@
+#ifndef WORLDVIEW_H
+#define WORLDVIEW_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <QString>
+
+#include "ambulance.h"
+#include "supplier.h"
+#include "clinic.h"
+#include "hospital.h"
+
+#define WORLD_VIEW_OCCUPANCY_BINS 10    // Classes de l'histogramme d'occupation des lits, la dernière compte les hôpitaux pleins
+#define WORLD_VIEW_KERNEL_CHUNK 256     // Valeurs traitées par tranche dans les agrégats qui passent par un tampon
+
+/**
+ * @brief Agrégats sur des colonnes contiguës
+ * Boucles simples sur des tableaux d'entiers, sans appel ni branche dépendant des données, que le compilateur vectorise
+ */
+namespace WorldKernels {
+
+/**
+ * @brief sum
+ * @return La somme des count valeurs, sur 64 bits
+ */
+int64_t sum(const int32_t* values, size_t count);
+
+/**
+ * @brief minMax
+ * @param min Reçoit la plus petite valeur, 0 si count est nul
+ * @param max Reçoit la plus grande valeur, 0 si count est nul
+ */
+void minMax(const int32_t* values, size_t count, int32_t& min, int32_t& max);
+
+/**
+ * @brief occupancyHistogram
+ * @param occupied Lits occupés de chaque hôpital
+ * @param capacity Lits de chaque hôpital
+ * @param bins Reçoit le nombre d'hôpitaux par classe d'occupation : la classe b compte une occupation dans
+ *             [b / nbBins, (b + 1) / nbBins[, la classe nbBins les hôpitaux pleins
+ * @param nbBins Nombre de classes avant celle des hôpitaux pleins, bins en contient nbBins + 1
+ */
+void occupancyHistogram(const int32_t* occupied, const int32_t* capacity, size_t count, uint64_t* bins, int nbBins);
+
+}
+
+/**
+ * @brief The WorldView class
+ * Copie en colonnes (struct of arrays) de l'état chaud de toutes les entités : argent, stock de chaque item,
+ * patients, argent versé aux employés et, pour les hôpitaux, lits, patients sortis et revenus des patients soignés.
+ * Les colonnes ne sont pas tenues à jour : chaque capture relit toutes les entités, pour un coût linéaire en leur nombre.
+ * Seuls les agrégats qui suivent lisent des tableaux contigus, sans appel virtuel ; une capture ne vaut donc que pour
+ * plusieurs agrégats calculés sur le même état, comme le bilan de fin de simulation.
+ * Les entités sont rangées dans l'ordre de Utils::getSellers : ambulances, fournisseurs, cliniques puis hôpitaux.
+ * L'argent et les stocks d'une entité sont lus ensemble dans son instantané (getSnapshot), le reste sans verrou :
+ * une capture pendant la simulation est cohérente par entité pour l'argent et les stocks, approchée pour les compteurs.
+ */
+class WorldView {
+public:
+    /**
+     * @brief capture
+     * Relit toutes les entités : par entité un instantané et des appels virtuels, par hôpital trois prises de son mutex
+     * (lits occupés, patients sortis, revenus des patients soignés). Les colonnes ne sont réallouées que si le nombre
+     * d'entités a changé depuis la capture précédente de la même vue.
+     */
+    void capture(const std::vector<Ambulance*>& ambulances, const std::vector<Supplier*>& suppliers,
+                 const std::vector<Clinic*>& clinics, const std::vector<Hospital*>& hospitals);
+
+    size_t size() const { return funds.size(); }
+
+    int64_t getTotalFunds() const { return WorldKernels::sum(funds.data(), funds.size()); }
+    int64_t getTotalPaidToWorkers() const { return WorldKernels::sum(paidToWorkers.data(), paidToWorkers.size()); }
+    int64_t getTotalPatients() const { return WorldKernels::sum(patients.data(), patients.size()); }
+    int64_t getTotalStock(ItemType item) const;
+    int64_t getTotalDischarged() const { return WorldKernels::sum(discharged.data(), discharged.size()); }
+    int64_t getTotalFundingFromHealed() const { return WorldKernels::sum(fundingFromHealed.data(), fundingFromHealed.size()); }
+    int64_t getTotalOccupiedBeds() const { return WorldKernels::sum(occupiedBeds.data(), occupiedBeds.size()); }
+    int64_t getTotalBeds() const { return WorldKernels::sum(beds.data(), beds.size()); }
+
+    void getFundsRange(int32_t& min, int32_t& max) const { WorldKernels::minMax(funds.data(), funds.size(), min, max); }
+
+    /**
+     * @brief patientsOf
+     * @return Les patients que détient l'entité, aucun pour un fournisseur
+     */
+    static int patientsOf(Ambulance* ambulance) { return ambulance->getNumberPatients(); }
+    static int patientsOf(Supplier*) { return 0; }
+    static int patientsOf(Clinic* clinic) { return clinic->getNumberPatients(); }
+    static int patientsOf(Hospital* hospital) { return hospital->getNumberPatients(); }
+
+    /**
+     * @brief getOccupancyHistogram
+     * @return Le nombre d'hôpitaux par classe d'occupation des lits, WORLD_VIEW_OCCUPANCY_BINS + 1 classes
+     */
+    std::array<uint64_t, WORLD_VIEW_OCCUPANCY_BINS + 1> getOccupancyHistogram() const;
+
+    /**
+     * @brief report
+     * @return L'argent, les patients et l'occupation des lits agrégés sur toutes les entités
+     */
+    QString report() const;
+
+private:
+    // Une valeur par entité
+    std::vector<int32_t> funds;
+    std::vector<int32_t> paidToWorkers;
+    std::vector<int32_t> patients;
+    std::array<std::vector<int32_t>, NB_ITEM_TYPES> stocks;
+
+    // Une valeur par hôpital
+    std::vector<int32_t> occupiedBeds;
+    std::vector<int32_t> beds;
+    std::vector<int32_t> discharged;
+    std::vector<int32_t> fundingFromHealed;
+
+    template<typename T>
+    void captureSellers(const std::vector<T*>& sellers, size_t& index);
+};
+
+#endif // WORLDVIEW_H